@@ -120,11 +120,15 @@ class GetInstVarsVisitor : public ir::IrVisitor {
 
 }  // namespace
 
-InstToVars::InstToVars(const ir::Program& program) : program_(program) {}
+InstToVars::InstToVars(ir::ProgramPtr_t program)
+    : program_(CHECK_NOTNULL(std::move(program))) {}
 
-auto InstToVars::Analyze(const string& function_name) -> Solution {
+InstToVars::InstToVars(const ir::Program& program)
+    : InstToVars(make_shared<const ir::Program>(program)) {}
+
+auto InstToVars::Analyze(const string& function_name) const -> Solution {
   // The function being analyzed.
-  const auto& function = program_[function_name];
+  const auto& function = (*program_)[function_name];
 
   GetInstVarsVisitor visitor;
   auto soln = visitor.GetSoln(function);
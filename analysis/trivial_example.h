@@ -16,15 +16,20 @@ class InstToVars {
   // A solution is a map from instructions to sets of variables.
   using Solution = unordered_map<InstPtr_t, VarSet>;
 
-  // The constructor argument is the program to analyze.
+  // The constructor argument is the program to analyze. It is shared rather
+  // than copied, so constructing an analysis costs the same however big the
+  // program is.
+  InstToVars(ir::ProgramPtr_t program);
+
+  // Like the above, but analyzes a copy of 'program'.
   InstToVars(const ir::Program& program);
 
   // Analyze the given function and return its solution.
-  Solution Analyze(const string& function_name);
+  Solution Analyze(const string& function_name) const;
 
  private:
   // The program being analyzed.
-  ir::Program program_;
+  ir::ProgramPtr_t program_;
 };
 
 }  // namespace analysis::trivial_example
@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 namespace {
 
 using namespace analysis;
@@ -118,6 +120,41 @@ TEST(TrivialExampleTest, SecondTest) {
   EXPECT_EQ(SolnToString(soln_foo), expected_foo);
 }
 
+TEST(TrivialExampleTest, SharedProgram) {
+  string code = R"""(
+    function main() -> int {
+      entry:
+        x:int = $copy 6
+        y:int = $arith add x:int 1
+        $ret y:int
+    }
+  )""";
+
+  ir::ProgramPtr_t program =
+      make_shared<const ir::Program>(ir::Program::FromString(code));
+
+  // Analyses on several threads share the one program.
+  constexpr int kNumThreads = 4;
+  vector<unordered_map<string, set<string>>> solns(kNumThreads);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&program, &solns, i] {
+      InstToVars analysis(program);
+      solns[i] = SolnToString(analysis.Analyze("main"));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  unordered_map<string, set<string>> expected{
+      {"entry.1", {"x"}},
+      {"entry.2", {"y"}},
+  };
+  for (const auto& soln : solns) EXPECT_EQ(soln, expected);
+
+  InstToVars analysis(program);
+  EXPECT_EQ(program.use_count(), 2);
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -0,0 +1,96 @@
+#include "ir/cfg.h"
+
+namespace ir {
+
+Cfg::Cfg(const Function& function) : num_blocks_(function.blocks().size()) {
+  if (const BasicBlock* entry = function.FindBlock(util::Symbol("entry"))) {
+    entry_ = entry->id();
+  }
+
+  // The successors, from the terminators.
+  succ_begin_.reserve(num_blocks_ + 1);
+  succs_.reserve(num_blocks_ * 2);
+  const auto add_succ = [&](const BasicBlock* target) {
+    if (target != nullptr) succs_.push_back(target->id());
+  };
+  for (const BasicBlock* bb : function.blocks()) {
+    succ_begin_.push_back(succs_.size());
+    const Instruction& terminator = bb->body().back();
+    if (terminator.GetOpcode() == Instruction::kJump) {
+      add_succ(terminator.AsJump().target());
+    } else if (terminator.GetOpcode() == Instruction::kBranch) {
+      const BranchInst& branch = terminator.AsBranch();
+      add_succ(branch.target_true());
+      if (branch.target_false() != branch.target_true()) {
+        add_succ(branch.target_false());
+      }
+    }
+  }
+  succ_begin_.push_back(succs_.size());
+
+  Finish();
+}
+
+Cfg Cfg::Reverse() const {
+  vector<int> exits;
+  for (int i = 0; i < num_blocks_; ++i) {
+    if (successors(i).empty()) exits.push_back(i);
+  }
+
+  // The successors in the reverse CFG are the predecessors in this one, plus
+  // the exit blocks for the virtual exit block (if there is one).
+  Cfg reverse;
+  reverse.num_blocks_ = num_blocks_;
+  reverse.succ_begin_ = pred_begin_;
+  reverse.succs_ = preds_;
+  if (exits.size() == 1) {
+    reverse.entry_ = exits[0];
+  } else if (exits.size() > 1) {
+    reverse.entry_ = reverse.num_blocks_++;
+    reverse.succs_.insert(reverse.succs_.end(), exits.begin(), exits.end());
+    reverse.succ_begin_.push_back(reverse.succs_.size());
+  }
+  reverse.Finish();
+  return reverse;
+}
+
+void Cfg::Finish() {
+  // The predecessors, by counting sort of the edges on their targets, so that
+  // each block's predecessors come out in order of id.
+  pred_begin_.assign(num_blocks_ + 1, 0);
+  for (int succ : succs_) ++pred_begin_[succ + 1];
+  for (int i = 0; i < num_blocks_; ++i) pred_begin_[i + 1] += pred_begin_[i];
+  preds_.resize(succs_.size());
+  vector<int> next_pred(pred_begin_.begin(), pred_begin_.end() - 1);
+  for (int i = 0; i < num_blocks_; ++i) {
+    for (int succ : successors(i)) preds_[next_pred[succ]++] = i;
+  }
+
+  // The postorder, by a depth-first search from the entry block with an
+  // explicit stack of (block, index of the next successor to visit).
+  rpo_number_.assign(num_blocks_, -1);
+  if (entry_ < 0) return;
+  vector<char> visited(num_blocks_, false);
+  vector<pair<int, size_t>> stack;
+  visited[entry_] = true;
+  stack.emplace_back(entry_, 0);
+  while (!stack.empty()) {
+    auto& [id, next] = stack.back();
+    Ids succs = successors(id);
+    if (next < succs.size()) {
+      int succ = succs[next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.emplace_back(succ, 0);
+      }
+    } else {
+      postorder_.push_back(id);
+      stack.pop_back();
+    }
+  }
+
+  rpo_.assign(postorder_.rbegin(), postorder_.rend());
+  for (size_t i = 0; i < rpo_.size(); ++i) rpo_number_[rpo_[i]] = i;
+}
+
+}  // namespace ir
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ir/ir.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// The control-flow graph of a function, over the ids of its basic blocks (see
+// Function::blocks()), so that analyses can keep per-block state in vectors.
+// The edges come from the resolved targets of the jumps and branches (see
+// JumpInst::target()); a branch whose labels are the same has a single edge,
+// and a target that isn't resolved (in an unverified function) has none. The
+// edges are stored in two flat arrays rather than in a vector per block, and
+// the orders are computed without recursion, so a CFG with millions of blocks
+// is fine. Usually obtained through Function::cfg(), which caches it.
+class Cfg {
+ public:
+  // A read-only sequence of block ids.
+  class Ids {
+   public:
+    Ids(const int* begin, const int* end) : begin_(begin), end_(end) {}
+
+    const int* begin() const { return begin_; }
+    const int* end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    int operator[](size_t index) const { return begin_[index]; }
+
+   private:
+    const int* begin_;
+    const int* end_;
+  };
+
+  explicit Cfg(const Function& function);
+
+  // Returns the reverse of this CFG, for post-dominators and other backward
+  // problems. Its edges are reversed, and its entry block is the exit block
+  // (the block without successors, normally ending in a $ret) if there is
+  // exactly one. If there are several, its entry block is instead a virtual
+  // exit block with id num_blocks(), whose successors are the exit blocks.
+  // Blocks that can't reach an exit block (e.g., in an infinite loop) aren't
+  // reachable in the reverse CFG. Usually obtained through
+  // Function::reverse_cfg(), which caches it.
+  Cfg Reverse() const;
+
+  // Returns the number of blocks, including a virtual exit block if there is
+  // one (see Reverse()).
+  int num_blocks() const { return num_blocks_; }
+
+  // Returns the id of the entry block, or -1 if the function has none.
+  int entry() const { return entry_; }
+
+  // Returns the successors of a block, in the order of its terminator's
+  // labels.
+  Ids successors(int id) const {
+    return Ids(succs_.data() + succ_begin_[id],
+               succs_.data() + succ_begin_[id + 1]);
+  }
+
+  // Returns the predecessors of a block, in order of id.
+  Ids predecessors(int id) const {
+    return Ids(preds_.data() + pred_begin_[id],
+               preds_.data() + pred_begin_[id + 1]);
+  }
+
+  // Returns the blocks reachable from the entry block in postorder, and in
+  // reverse postorder (in which each block comes before its successors,
+  // other than along back edges). Successors are visited in order.
+  const vector<int>& postorder() const { return postorder_; }
+  const vector<int>& reverse_postorder() const { return rpo_; }
+
+  // Returns the index of a block in reverse_postorder(), or -1 if it isn't
+  // reachable from the entry block.
+  int rpo_number(int id) const { return rpo_number_[id]; }
+
+  bool IsReachable(int id) const { return rpo_number_[id] >= 0; }
+
+ private:
+  Cfg() = default;
+
+  // Fills in the predecessors and the orders from the successors.
+  void Finish();
+
+  int num_blocks_ = 0;
+  int entry_ = -1;
+
+  // The successors of block i are succs_[succ_begin_[i]..succ_begin_[i + 1]),
+  // and likewise for the predecessors.
+  vector<int> succ_begin_;
+  vector<int> succs_;
+  vector<int> pred_begin_;
+  vector<int> preds_;
+
+  vector<int> postorder_;
+  vector<int> rpo_;
+  vector<int> rpo_number_;
+};
+
+}  // namespace ir
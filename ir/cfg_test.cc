@@ -0,0 +1,192 @@
+// Tests for control-flow graphs.
+
+#include "ir/cfg.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace {
+
+using namespace ir;
+
+// Returns the labels of the blocks with the given ids.
+vector<string> Labels(const Function& function, const vector<int>& ids) {
+  vector<string> labels;
+  for (int id : ids) labels.push_back(function.blocks()[id]->label());
+  return labels;
+}
+
+vector<string> Labels(const Function& function, Cfg::Ids ids) {
+  return Labels(function, vector<int>(ids.begin(), ids.end()));
+}
+
+const char kFunction[] = R"""(function foo(p:int) -> int {
+entry:
+  $branch p:int loop exit
+
+loop:
+  $branch p:int body exit
+
+body:
+  $jump loop
+
+exit:
+  $ret 0
+
+dead:
+  $branch p:int exit exit
+}
+)""";
+
+TEST(CfgTest, Edges) {
+  Function foo = Function::FromString(kFunction);
+  const Cfg& cfg = foo.cfg();
+  ASSERT_EQ(cfg.num_blocks(), 5);
+  EXPECT_EQ(cfg.entry(), foo["entry"].id());
+
+  int loop = foo["loop"].id();
+  int exit = foo["exit"].id();
+  int dead = foo["dead"].id();
+  EXPECT_EQ(Labels(foo, cfg.successors(cfg.entry())),
+            vector<string>({"loop", "exit"}));
+  EXPECT_EQ(Labels(foo, cfg.successors(loop)),
+            vector<string>({"body", "exit"}));
+  EXPECT_TRUE(cfg.successors(exit).empty());
+
+  // A branch to the same block twice is a single edge.
+  EXPECT_EQ(Labels(foo, cfg.successors(dead)), vector<string>({"exit"}));
+
+  EXPECT_EQ(Labels(foo, cfg.predecessors(loop)),
+            vector<string>({"entry", "body"}));
+  EXPECT_EQ(Labels(foo, cfg.predecessors(exit)),
+            vector<string>({"entry", "loop", "dead"}));
+  EXPECT_TRUE(cfg.predecessors(cfg.entry()).empty());
+}
+
+TEST(CfgTest, Orders) {
+  Function foo = Function::FromString(kFunction);
+  const Cfg& cfg = foo.cfg();
+
+  EXPECT_EQ(Labels(foo, cfg.postorder()),
+            vector<string>({"body", "exit", "loop", "entry"}));
+  EXPECT_EQ(Labels(foo, cfg.reverse_postorder()),
+            vector<string>({"entry", "loop", "exit", "body"}));
+  for (size_t i = 0; i < cfg.reverse_postorder().size(); ++i) {
+    EXPECT_EQ(cfg.rpo_number(cfg.reverse_postorder()[i]), i);
+  }
+
+  // Unreachable blocks are in neither order.
+  EXPECT_TRUE(cfg.IsReachable(foo["body"].id()));
+  EXPECT_FALSE(cfg.IsReachable(foo["dead"].id()));
+  EXPECT_EQ(cfg.rpo_number(foo["dead"].id()), -1);
+}
+
+TEST(CfgTest, Reverse) {
+  // A single exit block is the entry block of the reverse CFG.
+  Function foo = Function::FromString(kFunction);
+  const Cfg& reverse = foo.reverse_cfg();
+  ASSERT_EQ(reverse.num_blocks(), 5);
+  EXPECT_EQ(reverse.entry(), foo["exit"].id());
+  EXPECT_EQ(Labels(foo, reverse.successors(foo["exit"].id())),
+            vector<string>({"entry", "loop", "dead"}));
+  EXPECT_EQ(Labels(foo, reverse.predecessors(foo["loop"].id())),
+            vector<string>({"body", "exit"}));
+  EXPECT_EQ(Labels(foo, reverse.reverse_postorder()),
+            vector<string>({"exit", "dead", "loop", "body", "entry"}));
+  EXPECT_EQ(&foo.reverse_cfg(), &reverse);
+
+  // Several exit blocks are the successors of a virtual exit block, and blocks
+  // that can't reach an exit are unreachable.
+  Function bar = Function::FromString(R"""(function bar(p:int) -> int {
+entry:
+  $branch p:int left right
+
+left:
+  $ret 0
+
+right:
+  $branch p:int spin done
+
+spin:
+  $jump spin
+
+done:
+  $ret 1
+}
+)""");
+  const Cfg& bar_reverse = bar.reverse_cfg();
+  ASSERT_EQ(bar_reverse.num_blocks(), 6);
+  EXPECT_EQ(bar_reverse.entry(), 5);
+  EXPECT_EQ(Labels(bar, bar_reverse.successors(5)),
+            vector<string>({"left", "done"}));
+  EXPECT_EQ(vector<int>(bar_reverse.predecessors(bar["done"].id()).begin(),
+                        bar_reverse.predecessors(bar["done"].id()).end()),
+            vector<int>({5}));
+  EXPECT_TRUE(bar_reverse.IsReachable(bar["entry"].id()));
+  EXPECT_FALSE(bar_reverse.IsReachable(bar["spin"].id()));
+}
+
+// The CFG is built once and shared by all threads; copies build their own,
+// and moves take it over.
+TEST(CfgTest, Cached) {
+  Function foo = Function::FromString(kFunction);
+  vector<const Cfg*> cfgs(8);
+  vector<std::thread> threads;
+  for (size_t i = 0; i < cfgs.size(); ++i) {
+    threads.emplace_back([&foo, &cfgs, i] { cfgs[i] = &foo.cfg(); });
+  }
+  for (auto& thread : threads) thread.join();
+  for (const Cfg* cfg : cfgs) EXPECT_EQ(cfg, cfgs[0]);
+  EXPECT_EQ(&foo.cfg(), cfgs[0]);
+
+  Function copy = foo;
+  EXPECT_NE(&copy.cfg(), cfgs[0]);
+  EXPECT_EQ(copy.cfg().reverse_postorder(), foo.cfg().reverse_postorder());
+  Function moved = std::move(foo);
+  EXPECT_EQ(&moved.cfg(), cfgs[0]);
+
+  // Likewise for assignment, which drops the CFG assigned over.
+  Function assigned = Function::FromString(kFunction);
+  assigned.cfg();
+  assigned = moved;
+  EXPECT_NE(&assigned.cfg(), cfgs[0]);
+  EXPECT_EQ(assigned.cfg().reverse_postorder(),
+            moved.cfg().reverse_postorder());
+  assigned = std::move(moved);
+  EXPECT_EQ(&assigned.cfg(), cfgs[0]);
+}
+
+// A long chain of blocks (deeper than the stack would allow if the search
+// were recursive).
+TEST(CfgTest, DeepChain) {
+  constexpr int kNumBlocks = 200000;
+  vector<BasicBlock> blocks;
+  blocks.reserve(kNumBlocks);
+  auto label = [](int i) {
+    return i == 0 ? string("entry") : "b" + std::to_string(i);
+  };
+  for (int i = 0; i < kNumBlocks - 1; ++i) {
+    blocks.emplace_back(label(i), vector<Instruction>{JumpInst(label(i + 1))});
+  }
+  blocks.emplace_back(label(kNumBlocks - 1),
+                      vector<Instruction>{RetInst(Operand(0))});
+  Function chain("chain", Type::Int(), {}, std::move(blocks));
+
+  const Cfg& cfg = chain.cfg();
+  ASSERT_EQ(cfg.reverse_postorder().size(), kNumBlocks);
+  for (int i = 0; i < kNumBlocks; ++i) {
+    EXPECT_EQ(cfg.reverse_postorder()[i], i);
+    EXPECT_EQ(cfg.postorder()[i], kNumBlocks - 1 - i);
+  }
+  EXPECT_EQ(cfg.predecessors(kNumBlocks - 1)[0], kNumBlocks - 2);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
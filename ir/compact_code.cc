@@ -0,0 +1,198 @@
+#include "ir/compact_code.h"
+
+namespace ir {
+
+class CompactCode::Builder {
+ public:
+  Builder(const Function& function, CompactCode& code)
+      : function_(function), code_(code) {}
+
+  void Build() {
+    code_.vars_ = function_.locals();
+    code_.num_locals_ = code_.vars_.size();
+    code_.records_.reserve(function_.instructions().size());
+    code_.block_begin_.reserve(function_.blocks().size() + 1);
+    for (const BasicBlock* bb : function_.blocks()) {
+      code_.block_begin_.push_back(code_.records_.size());
+      for (const Instruction& inst : bb->body()) Add(inst);
+    }
+    code_.block_begin_.push_back(code_.records_.size());
+  }
+
+ private:
+  // Appends the record for 'inst'.
+  void Add(const Instruction& inst) {
+    record_ = &code_.records_.emplace_back();
+    record_->opcode = inst.GetOpcode();
+    record_->operation = 0;
+    record_->kinds = 0;
+    std::fill(std::begin(record_->slots), std::end(record_->slots), 0);
+    slot_ = 0;
+
+    switch (inst.GetOpcode()) {
+      case Instruction::kArith: {
+        const ArithInst& arith = inst.AsArith();
+        record_->operation = arith.operation();
+        AddVar(arith.lhs());
+        AddOperand(arith.op1());
+        AddOperand(arith.op2());
+        break;
+      }
+
+      case Instruction::kCmp: {
+        const CmpInst& cmp = inst.AsCmp();
+        record_->operation = cmp.operation();
+        AddVar(cmp.lhs());
+        AddOperand(cmp.op1());
+        AddOperand(cmp.op2());
+        break;
+      }
+
+      case Instruction::kPhi:
+        AddVar(inst.AsPhi().lhs());
+        AddList(inst.AsPhi().ops());
+        break;
+
+      case Instruction::kCopy:
+        AddVar(inst.AsCopy().lhs());
+        AddOperand(inst.AsCopy().rhs());
+        break;
+
+      case Instruction::kAlloc:
+        AddVar(inst.AsAlloc().lhs());
+        break;
+
+      case Instruction::kAddrof:
+        AddVar(inst.AsAddrOf().lhs());
+        AddVar(inst.AsAddrOf().rhs());
+        break;
+
+      case Instruction::kLoad:
+        AddVar(inst.AsLoad().lhs());
+        AddVar(inst.AsLoad().src());
+        break;
+
+      case Instruction::kStore:
+        AddVar(inst.AsStore().dst());
+        AddOperand(inst.AsStore().value());
+        break;
+
+      case Instruction::kGep: {
+        const GepInst& gep = inst.AsGep();
+        AddVar(gep.lhs());
+        AddVar(gep.src_ptr());
+        AddOperand(gep.index());
+        AddSymbols({gep.field_name_symbol()});
+        break;
+      }
+
+      case Instruction::kSelect: {
+        const SelectInst& select = inst.AsSelect();
+        AddVar(select.lhs());
+        AddOperand(select.condition());
+        AddOperand(select.true_op());
+        AddOperand(select.false_op());
+        break;
+      }
+
+      case Instruction::kCall:
+        AddVar(inst.AsCall().lhs());
+        AddSymbols({inst.AsCall().callee_symbol()});
+        AddList(inst.AsCall().args());
+        break;
+
+      case Instruction::kICall:
+        AddVar(inst.AsICall().lhs());
+        AddVar(inst.AsICall().func_ptr());
+        AddList(inst.AsICall().args());
+        break;
+
+      case Instruction::kRet:
+        AddOperand(inst.AsRet().retval());
+        break;
+
+      case Instruction::kJump:
+        AddBlock(inst.AsJump().target());
+        AddSymbols({inst.AsJump().label_symbol()});
+        break;
+
+      case Instruction::kBranch: {
+        const BranchInst& branch = inst.AsBranch();
+        AddOperand(branch.condition());
+        AddBlock(branch.target_true());
+        AddBlock(branch.target_false());
+        AddSymbols(
+            {branch.label_true_symbol(), branch.label_false_symbol()});
+        break;
+      }
+    }
+  }
+
+  // Fills in the next slot of the current record.
+  void AddSlot(Kind kind, int32_t value) {
+    CHECK_LT(slot_, kNumSlots);
+    record_->kinds |= static_cast<uint16_t>(kind << (4 * slot_));
+    record_->slots[slot_++] = value;
+  }
+
+  void AddVar(const VarPtr_t& var) { AddSlot(kVar, VarNumber(var.get())); }
+
+  void AddOperand(const Operand& op) {
+    auto [kind, value] = Encode(op);
+    AddSlot(kind, value);
+  }
+
+  void AddBlock(const BasicBlock* bb) {
+    AddSlot(kBlock, bb == nullptr ? -1 : bb->id());
+  }
+
+  // Adds symbols to the end of 'symbols_' and their number to the current
+  // record.
+  void AddSymbols(std::initializer_list<util::Symbol> symbols) {
+    AddSlot(kSymbol, code_.symbols_.size());
+    code_.symbols_.insert(code_.symbols_.end(), symbols);
+  }
+
+  // Adds the operands to the out-of-line storage, and their start and count
+  // to the current record.
+  void AddList(const vector<Operand>& ops) {
+    AddSlot(kList, code_.lists_.size());
+    AddSlot(kInt, ops.size());
+    for (const Operand& op : ops) {
+      auto [kind, value] = Encode(op);
+      code_.lists_.push_back({kind, value});
+    }
+  }
+
+  pair<Kind, int32_t> Encode(const Operand& op) {
+    if (op.IsConstInt()) return {kInt, op.GetInt()};
+    return {kVar, VarNumber(op.GetVar().get())};
+  }
+
+  // Returns the number of 'var' in 'vars_', adding it if it's a global that
+  // hasn't been seen yet.
+  int32_t VarNumber(const Variable* var) {
+    int id = function_.LocalId(var);
+    if (id >= 0) return id;
+    auto [it, inserted] =
+        global_numbers_.emplace(var, static_cast<int32_t>(code_.vars_.size()));
+    if (inserted) code_.vars_.push_back(var);
+    return it->second;
+  }
+
+  const Function& function_;
+  CompactCode& code_;
+
+  // The record being filled in and its next slot.
+  Record* record_ = nullptr;
+  int slot_ = 0;
+
+  // Global variable ==> number in 'vars_'.
+  unordered_map<const Variable*, int32_t> global_numbers_;
+};
+
+CompactCode::CompactCode(const Function& function) {
+  Builder(function, *this).Build();
+}
+
+}  // namespace ir
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "ir/ir.h"
+#include "util/standard_includes.h"
+#include "util/symbol.h"
+
+namespace ir {
+
+// A flat encoding of a function's instructions, for passes that scan every
+// instruction and would rather not chase (or copy) the VarPtr_ts, vectors, and
+// variants that an Instruction is made of. Each instruction is a fixed-size
+// Record: an opcode byte, an operation byte, and four 32-bit slots that hold
+// variable numbers, integer constants, block ids, or symbol numbers, with a
+// nibble per slot saying which. The variable-length operand lists of phis and
+// calls are stored out of line, in one array for the whole function. Records
+// are indexed by instruction id (see Function::instructions()), so each
+// block's records are contiguous and in layout order.
+//
+// The records are decoded through views that mirror the instruction classes
+// (e.g., Inst::AsArith() returns an ArithView whose lhs(), op1(), and op2()
+// correspond to ArithInst's). Variables are returned as plain pointers, owned
+// by the function, and the targets of calls and the resolved fields of geps
+// (which a Program fills in) aren't encoded. The Instructions are still the
+// function's representation; this is a read-only, derived copy. Usually
+// obtained through Function::compact_code(), which caches it.
+class CompactCode {
+ public:
+  // What a slot of a record (or an entry of an operand list) holds.
+  enum Kind : uint8_t {
+    kEmpty = 0,
+    kVar,     // A number in vars().
+    kInt,     // An integer constant (or a count).
+    kBlock,   // A block id; -1 if the label wasn't resolved.
+    kSymbol,  // A number in symbols().
+    kList,    // The start of an operand list in the out-of-line storage.
+  };
+
+  static constexpr int kNumSlots = 4;
+
+  struct Record {
+    uint8_t opcode;     // An Instruction::Opcode.
+    uint8_t operation;  // An ArithInst::Aop or CmpInst::Rop, otherwise 0.
+    uint16_t kinds;     // The Kind of slot i is in bits 4i..4i+3.
+    int32_t slots[kNumSlots];
+
+    Kind kind(int slot) const {
+      return static_cast<Kind>((kinds >> (4 * slot)) & 0xf);
+    }
+  };
+
+  static_assert(sizeof(Record) == 20, "Records should stay small");
+
+  // An operand of a list, stored out of line.
+  struct ListEntry {
+    Kind kind;
+    int32_t value;
+  };
+
+  // A decoded operand: a variable or an integer constant.
+  class OperandView {
+   public:
+    OperandView(const CompactCode* code, Kind kind, int32_t value)
+        : code_(code), kind_(kind), value_(value) {}
+
+    bool IsVariable() const { return kind_ == kVar; }
+    bool IsConstInt() const { return kind_ == kInt; }
+
+    const Variable* GetVar() const {
+      CHECK(IsVariable()) << "Operand is not a variable";
+      return code_->vars_[value_];
+    }
+
+    int GetInt() const {
+      CHECK(IsConstInt()) << "Operand is not an integer";
+      return value_;
+    }
+
+    // Returns the id of the variable in Function::locals(), or -1 if the
+    // operand is an integer or a global variable.
+    int local_id() const {
+      return IsVariable() && value_ < code_->num_locals_ ? value_ : -1;
+    }
+
+    const Type& GetType() const {
+      return IsVariable() ? GetVar()->type() : int_type_;
+    }
+
+   private:
+    inline static Type int_type_ = Type::Int();
+
+    const CompactCode* code_;
+    Kind kind_;
+    int32_t value_;
+  };
+
+  class ArithView;
+  class CmpView;
+  class PhiView;
+  class CopyView;
+  class AllocView;
+  class AddrOfView;
+  class LoadView;
+  class StoreView;
+  class GepView;
+  class SelectView;
+  class CallView;
+  class ICallView;
+  class RetView;
+  class JumpView;
+  class BranchView;
+
+  // A decoded instruction.
+  class Inst {
+   public:
+    Inst(const CompactCode* code, const Record* record)
+        : code_(code), record_(record) {}
+
+    Instruction::Opcode GetOpcode() const {
+      return static_cast<Instruction::Opcode>(record_->opcode);
+    }
+
+    const Record& record() const { return *record_; }
+
+    // The views of the particular type of instruction; these FATAL if the one
+    // called doesn't match GetOpcode().
+    ArithView AsArith() const;
+    CmpView AsCmp() const;
+    PhiView AsPhi() const;
+    CopyView AsCopy() const;
+    AllocView AsAlloc() const;
+    AddrOfView AsAddrOf() const;
+    LoadView AsLoad() const;
+    StoreView AsStore() const;
+    GepView AsGep() const;
+    SelectView AsSelect() const;
+    CallView AsCall() const;
+    ICallView AsICall() const;
+    RetView AsRet() const;
+    JumpView AsJump() const;
+    BranchView AsBranch() const;
+
+   protected:
+    // Returns the view for the instruction's opcode; FATALs if it isn't
+    // 'opcode'.
+    template <typename View>
+    View As(Instruction::Opcode opcode) const {
+      CHECK_EQ(GetOpcode(), opcode) << "Instruction has a different opcode";
+      return View(code_, record_);
+    }
+
+    OperandView Op(int slot) const {
+      return OperandView(code_, record_->kind(slot), record_->slots[slot]);
+    }
+    const Variable* Var(int slot) const { return Op(slot).GetVar(); }
+    util::Symbol Sym(int slot, int offset = 0) const {
+      return code_->symbols_[record_->slots[slot] + offset];
+    }
+
+    // The number of operands in the list starting at 'slot' (whose count is
+    // in the next slot), and the operand at 'index' in it.
+    int ListSize(int slot) const { return record_->slots[slot + 1]; }
+    OperandView ListOp(int slot, int index) const {
+      const ListEntry& entry = code_->lists_[record_->slots[slot] + index];
+      return OperandView(code_, entry.kind, entry.value);
+    }
+
+    const CompactCode* code_;
+    const Record* record_;
+  };
+
+  class ArithView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    OperandView op1() const { return Op(1); }
+    OperandView op2() const { return Op(2); }
+    ArithInst::Aop operation() const {
+      return static_cast<ArithInst::Aop>(record_->operation);
+    }
+  };
+
+  class CmpView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    OperandView op1() const { return Op(1); }
+    OperandView op2() const { return Op(2); }
+    CmpInst::Rop operation() const {
+      return static_cast<CmpInst::Rop>(record_->operation);
+    }
+  };
+
+  class PhiView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    int num_ops() const { return ListSize(1); }
+    OperandView op(int index) const { return ListOp(1, index); }
+  };
+
+  class CopyView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    OperandView rhs() const { return Op(1); }
+  };
+
+  class AllocView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+  };
+
+  class AddrOfView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    const Variable* rhs() const { return Var(1); }
+  };
+
+  class LoadView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    const Variable* src() const { return Var(1); }
+  };
+
+  class StoreView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* dst() const { return Var(0); }
+    OperandView value() const { return Op(1); }
+  };
+
+  class GepView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    const Variable* src_ptr() const { return Var(1); }
+    OperandView index() const { return Op(2); }
+    util::Symbol field_name_symbol() const { return Sym(3); }
+  };
+
+  class SelectView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    OperandView condition() const { return Op(1); }
+    OperandView true_op() const { return Op(2); }
+    OperandView false_op() const { return Op(3); }
+  };
+
+  class CallView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    util::Symbol callee_symbol() const { return Sym(1); }
+    int num_args() const { return ListSize(2); }
+    OperandView arg(int index) const { return ListOp(2, index); }
+  };
+
+  class ICallView : public Inst {
+   public:
+    using Inst::Inst;
+    const Variable* lhs() const { return Var(0); }
+    const Variable* func_ptr() const { return Var(1); }
+    int num_args() const { return ListSize(2); }
+    OperandView arg(int index) const { return ListOp(2, index); }
+  };
+
+  class RetView : public Inst {
+   public:
+    using Inst::Inst;
+    OperandView retval() const { return Op(0); }
+  };
+
+  // The targets are block ids (see JumpInst::target()).
+  class JumpView : public Inst {
+   public:
+    using Inst::Inst;
+    int target() const { return record_->slots[0]; }
+    util::Symbol label_symbol() const { return Sym(1); }
+  };
+
+  class BranchView : public Inst {
+   public:
+    using Inst::Inst;
+    OperandView condition() const { return Op(0); }
+    int target_true() const { return record_->slots[1]; }
+    int target_false() const { return record_->slots[2]; }
+    util::Symbol label_true_symbol() const { return Sym(3); }
+    util::Symbol label_false_symbol() const { return Sym(3, 1); }
+  };
+
+  explicit CompactCode(const Function& function);
+
+  // Returns the records indexed by instruction id.
+  const vector<Record>& records() const { return records_; }
+
+  // Returns the instruction with the given id.
+  Inst operator[](int id) const { return Inst(this, &records_[id]); }
+
+  // Returns the ids of the first instruction of a block and of the first
+  // instruction after it, by block id.
+  int block_begin(int id) const { return block_begin_[id]; }
+  int block_end(int id) const { return block_begin_[id + 1]; }
+
+  // Returns the variables that the records refer to: the function's locals
+  // (numbered the same as in Function::locals()), followed by the globals.
+  const vector<const Variable*>& vars() const { return vars_; }
+  int num_locals() const { return num_locals_; }
+
+  // Returns the out-of-line operand lists (see Kind::kList).
+  const vector<ListEntry>& lists() const { return lists_; }
+
+  // Returns the labels, field names, and callees that the records refer to.
+  const vector<util::Symbol>& symbols() const { return symbols_; }
+
+ private:
+  // Encodes the records.
+  class Builder;
+
+  vector<Record> records_;
+  vector<int> block_begin_;
+  vector<ListEntry> lists_;
+  vector<const Variable*> vars_;
+  int num_locals_ = 0;
+  vector<util::Symbol> symbols_;
+};
+
+inline CompactCode::ArithView CompactCode::Inst::AsArith() const {
+  return As<ArithView>(Instruction::kArith);
+}
+inline CompactCode::CmpView CompactCode::Inst::AsCmp() const {
+  return As<CmpView>(Instruction::kCmp);
+}
+inline CompactCode::PhiView CompactCode::Inst::AsPhi() const {
+  return As<PhiView>(Instruction::kPhi);
+}
+inline CompactCode::CopyView CompactCode::Inst::AsCopy() const {
+  return As<CopyView>(Instruction::kCopy);
+}
+inline CompactCode::AllocView CompactCode::Inst::AsAlloc() const {
+  return As<AllocView>(Instruction::kAlloc);
+}
+inline CompactCode::AddrOfView CompactCode::Inst::AsAddrOf() const {
+  return As<AddrOfView>(Instruction::kAddrof);
+}
+inline CompactCode::LoadView CompactCode::Inst::AsLoad() const {
+  return As<LoadView>(Instruction::kLoad);
+}
+inline CompactCode::StoreView CompactCode::Inst::AsStore() const {
+  return As<StoreView>(Instruction::kStore);
+}
+inline CompactCode::GepView CompactCode::Inst::AsGep() const {
+  return As<GepView>(Instruction::kGep);
+}
+inline CompactCode::SelectView CompactCode::Inst::AsSelect() const {
+  return As<SelectView>(Instruction::kSelect);
+}
+inline CompactCode::CallView CompactCode::Inst::AsCall() const {
+  return As<CallView>(Instruction::kCall);
+}
+inline CompactCode::ICallView CompactCode::Inst::AsICall() const {
+  return As<ICallView>(Instruction::kICall);
+}
+inline CompactCode::RetView CompactCode::Inst::AsRet() const {
+  return As<RetView>(Instruction::kRet);
+}
+inline CompactCode::JumpView CompactCode::Inst::AsJump() const {
+  return As<JumpView>(Instruction::kJump);
+}
+inline CompactCode::BranchView CompactCode::Inst::AsBranch() const {
+  return As<BranchView>(Instruction::kBranch);
+}
+
+}  // namespace ir
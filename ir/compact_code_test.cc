@@ -0,0 +1,292 @@
+// Tests for the compact encoding of instructions.
+
+#include "ir/compact_code.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace {
+
+using namespace ir;
+
+// Returns whether 'str' ends in 'suffix'.
+bool EndsWith(const string& str, const string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), string::npos, suffix) == 0;
+}
+
+void ExpectSame(CompactCode::OperandView view, const Operand& op) {
+  ASSERT_EQ(view.IsConstInt(), op.IsConstInt());
+  if (op.IsConstInt()) {
+    EXPECT_EQ(view.GetInt(), op.GetInt());
+  } else {
+    EXPECT_EQ(view.GetVar(), op.GetVar().get());
+  }
+  EXPECT_EQ(view.GetType(), op.GetType());
+}
+
+void ExpectSame(const Variable* var, const VarPtr_t& expected) {
+  EXPECT_EQ(var, expected.get());
+}
+
+void ExpectSame(int target, const BasicBlock* expected) {
+  EXPECT_EQ(target, expected == nullptr ? -1 : expected->id());
+}
+
+// Expects the compact form of 'inst' to decode to the same instruction.
+void ExpectSame(CompactCode::Inst view, const Instruction& inst) {
+  ASSERT_EQ(view.GetOpcode(), inst.GetOpcode());
+  switch (inst.GetOpcode()) {
+    case Instruction::kArith:
+      ExpectSame(view.AsArith().lhs(), inst.AsArith().lhs());
+      ExpectSame(view.AsArith().op1(), inst.AsArith().op1());
+      ExpectSame(view.AsArith().op2(), inst.AsArith().op2());
+      EXPECT_EQ(view.AsArith().operation(), inst.AsArith().operation());
+      break;
+
+    case Instruction::kCmp:
+      ExpectSame(view.AsCmp().lhs(), inst.AsCmp().lhs());
+      ExpectSame(view.AsCmp().op1(), inst.AsCmp().op1());
+      ExpectSame(view.AsCmp().op2(), inst.AsCmp().op2());
+      EXPECT_EQ(view.AsCmp().operation(), inst.AsCmp().operation());
+      break;
+
+    case Instruction::kPhi:
+      ExpectSame(view.AsPhi().lhs(), inst.AsPhi().lhs());
+      ASSERT_EQ(view.AsPhi().num_ops(), inst.AsPhi().ops().size());
+      for (int i = 0; i < view.AsPhi().num_ops(); ++i) {
+        ExpectSame(view.AsPhi().op(i), inst.AsPhi().ops()[i]);
+      }
+      break;
+
+    case Instruction::kCopy:
+      ExpectSame(view.AsCopy().lhs(), inst.AsCopy().lhs());
+      ExpectSame(view.AsCopy().rhs(), inst.AsCopy().rhs());
+      break;
+
+    case Instruction::kAlloc:
+      ExpectSame(view.AsAlloc().lhs(), inst.AsAlloc().lhs());
+      break;
+
+    case Instruction::kAddrof:
+      ExpectSame(view.AsAddrOf().lhs(), inst.AsAddrOf().lhs());
+      ExpectSame(view.AsAddrOf().rhs(), inst.AsAddrOf().rhs());
+      break;
+
+    case Instruction::kLoad:
+      ExpectSame(view.AsLoad().lhs(), inst.AsLoad().lhs());
+      ExpectSame(view.AsLoad().src(), inst.AsLoad().src());
+      break;
+
+    case Instruction::kStore:
+      ExpectSame(view.AsStore().dst(), inst.AsStore().dst());
+      ExpectSame(view.AsStore().value(), inst.AsStore().value());
+      break;
+
+    case Instruction::kGep:
+      ExpectSame(view.AsGep().lhs(), inst.AsGep().lhs());
+      ExpectSame(view.AsGep().src_ptr(), inst.AsGep().src_ptr());
+      ExpectSame(view.AsGep().index(), inst.AsGep().index());
+      EXPECT_EQ(view.AsGep().field_name_symbol(),
+                inst.AsGep().field_name_symbol());
+      break;
+
+    case Instruction::kSelect:
+      ExpectSame(view.AsSelect().lhs(), inst.AsSelect().lhs());
+      ExpectSame(view.AsSelect().condition(), inst.AsSelect().condition());
+      ExpectSame(view.AsSelect().true_op(), inst.AsSelect().true_op());
+      ExpectSame(view.AsSelect().false_op(), inst.AsSelect().false_op());
+      break;
+
+    case Instruction::kCall:
+      ExpectSame(view.AsCall().lhs(), inst.AsCall().lhs());
+      EXPECT_EQ(view.AsCall().callee_symbol(), inst.AsCall().callee_symbol());
+      ASSERT_EQ(view.AsCall().num_args(), inst.AsCall().args().size());
+      for (int i = 0; i < view.AsCall().num_args(); ++i) {
+        ExpectSame(view.AsCall().arg(i), inst.AsCall().args()[i]);
+      }
+      break;
+
+    case Instruction::kICall:
+      ExpectSame(view.AsICall().lhs(), inst.AsICall().lhs());
+      ExpectSame(view.AsICall().func_ptr(), inst.AsICall().func_ptr());
+      ASSERT_EQ(view.AsICall().num_args(), inst.AsICall().args().size());
+      for (int i = 0; i < view.AsICall().num_args(); ++i) {
+        ExpectSame(view.AsICall().arg(i), inst.AsICall().args()[i]);
+      }
+      break;
+
+    case Instruction::kRet:
+      ExpectSame(view.AsRet().retval(), inst.AsRet().retval());
+      break;
+
+    case Instruction::kJump:
+      ExpectSame(view.AsJump().target(), inst.AsJump().target());
+      EXPECT_EQ(view.AsJump().label_symbol(), inst.AsJump().label_symbol());
+      break;
+
+    case Instruction::kBranch:
+      ExpectSame(view.AsBranch().condition(), inst.AsBranch().condition());
+      ExpectSame(view.AsBranch().target_true(), inst.AsBranch().target_true());
+      ExpectSame(view.AsBranch().target_false(),
+                 inst.AsBranch().target_false());
+      EXPECT_EQ(view.AsBranch().label_true_symbol(),
+                inst.AsBranch().label_true_symbol());
+      EXPECT_EQ(view.AsBranch().label_false_symbol(),
+                inst.AsBranch().label_false_symbol());
+      break;
+  }
+}
+
+// Expects the compact form of 'function' to decode to its instructions.
+void ExpectSame(const CompactCode& code, const Function& function) {
+  ASSERT_EQ(code.records().size(), function.instructions().size());
+  for (size_t id = 0; id < function.instructions().size(); ++id) {
+    ExpectSame(code[id], *function.instructions()[id]);
+  }
+  for (const BasicBlock* bb : function.blocks()) {
+    EXPECT_EQ(code.block_begin(bb->id()), bb->body()[0].id());
+    EXPECT_EQ(code.block_end(bb->id()), bb->body()[0].id() + bb->body().size());
+  }
+}
+
+const char kProgram[] = R"""(struct node {
+  next: node*
+  value: int
+}
+
+function foo(p:node*, n:int) -> int {
+entry:
+  q:node* = $alloc
+  r:node** = $addrof q:node*
+  s:node* = $load r:node**
+  $store r:node** @nullptr:node*
+  f:int* = $gep s:node* 0 value
+  x:int = $arith mul n:int -7
+  c:int = $cmp lte x:int 2147483647
+  y:int = $select c:int x:int -2147483648
+  fp:int[node*,int]* = $copy @foo:int[node*,int]*
+  z:int = $icall fp:int[node*,int]*(p:node*, y:int)
+  w:int = $call foo(@nullptr:node*, 3)
+  $branch c:int exit loop
+
+loop:
+  v:int = $phi(x:int, w:int, 1)
+  $jump exit
+
+exit:
+  $ret z:int
+}
+
+function main() -> int {
+entry:
+  $ret 0
+}
+)""";
+
+TEST(CompactCodeTest, Views) {
+  Program program = Program::FromString(kProgram);
+  const Function& foo = program["foo"];
+  const CompactCode& code = foo.compact_code();
+  ExpectSame(code, foo);
+
+  // The locals are numbered as in the function, and the globals follow.
+  EXPECT_EQ(code.num_locals(), foo.locals().size());
+  ASSERT_EQ(code.vars().size(), foo.locals().size() + 2);
+  EXPECT_EQ(code.vars()[code.num_locals()]->name(), "@nullptr");
+  EXPECT_EQ(code.vars()[code.num_locals() + 1]->name(), "@foo");
+
+  const auto& entry = foo["entry"];
+  auto x = code[entry[5].id()].AsArith();
+  EXPECT_EQ(x.lhs()->name(), "x");
+  EXPECT_EQ(x.op1().local_id(), foo.LocalId(x.op1().GetVar()));
+  EXPECT_EQ(x.op2().GetInt(), -7);
+  EXPECT_EQ(x.op2().local_id(), -1);
+  EXPECT_EQ(x.operation(), ArithInst::kMultiply);
+  EXPECT_EQ(code[entry[6].id()].AsCmp().op2().GetInt(), 2147483647);
+  EXPECT_EQ(code[entry[7].id()].AsSelect().false_op().GetInt(),
+            -2147483648);
+
+  auto call = code[entry[10].id()].AsCall();
+  EXPECT_EQ(call.callee_symbol(), util::Symbol("foo"));
+  ASSERT_EQ(call.num_args(), 2);
+  EXPECT_EQ(call.arg(0).GetVar()->name(), "@nullptr");
+  EXPECT_EQ(call.arg(0).local_id(), -1);
+  EXPECT_EQ(call.arg(1).GetInt(), 3);
+
+  auto branch = code[entry[11].id()].AsBranch();
+  EXPECT_EQ(branch.target_true(), foo["exit"].id());
+  EXPECT_EQ(branch.target_false(), foo["loop"].id());
+
+  auto phi = code[foo["loop"][0].id()].AsPhi();
+  ASSERT_EQ(phi.num_ops(), 3);
+  EXPECT_EQ(phi.op(1).GetVar()->name(), "w");
+  EXPECT_EQ(phi.op(2).GetInt(), 1);
+
+  // Each block's records are contiguous, in layout order.
+  EXPECT_EQ(code.block_begin(foo["entry"].id()), 0);
+  EXPECT_EQ(code.block_end(foo["entry"].id()), entry.body().size());
+  EXPECT_EQ(code.block_end(foo["loop"].id()),
+            code.block_begin(foo["exit"].id()));
+}
+
+// Jumps and branches outside of a function have no targets.
+TEST(CompactCodeTest, UnresolvedTargets) {
+  Function foo = Function::FromString(R"""(function foo(p:int) -> int {
+entry:
+  $branch p:int entry nowhere
+}
+)""");
+  auto branch = foo.compact_code()[0].AsBranch();
+  EXPECT_EQ(branch.target_true(), 0);
+  EXPECT_EQ(branch.target_false(), -1);
+  EXPECT_EQ(branch.label_false_symbol(), util::Symbol("nowhere"));
+}
+
+TEST(CompactCodeTest, TestData) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (!EndsWith(filename, ".ir")) continue;
+    Program program = Program::FromFile(filename);
+    for (const auto& [name, function] : program.functions()) {
+      SCOPED_TRACE(filename + ": " + name);
+      ExpectSame(function->compact_code(), *function);
+    }
+  }
+}
+
+// The encoding is built once; copies build their own, and moves take it
+// over.
+TEST(CompactCodeTest, Cached) {
+  Function foo = Function::FromString(R"""(function foo() -> int {
+entry:
+  $ret 0
+}
+)""");
+  const CompactCode* code = &foo.compact_code();
+  EXPECT_EQ(&foo.compact_code(), code);
+  Function copy = foo;
+  EXPECT_NE(&copy.compact_code(), code);
+  ExpectSame(copy.compact_code(), copy);
+  Function moved = std::move(foo);
+  EXPECT_EQ(&moved.compact_code(), code);
+}
+
+TEST(CompactCodeDeathTest, WrongView) {
+  Function foo = Function::FromString(R"""(function foo() -> int {
+entry:
+  $ret 0
+}
+)""");
+  EXPECT_DEATH(foo.compact_code()[0].AsJump(), "different opcode");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
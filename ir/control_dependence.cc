@@ -0,0 +1,57 @@
+#include "ir/control_dependence.h"
+
+namespace ir {
+
+namespace {
+
+// Sorts 'pairs' by their first elements into 'begin' and 'seconds', so that
+// the seconds of the pairs whose first element is i are seconds[begin[i]..
+// begin[i + 1]), in the order of 'pairs'.
+void GroupByFirst(int num_blocks, const vector<pair<int, int>>& pairs,
+                  vector<int>& begin, vector<int>& seconds) {
+  begin.assign(num_blocks + 1, 0);
+  for (const auto& [first, second] : pairs) ++begin[first + 1];
+  for (int i = 0; i < num_blocks; ++i) begin[i + 1] += begin[i];
+  seconds.resize(pairs.size());
+  vector<int> next(begin.begin(), begin.end() - 1);
+  for (const auto& [first, second] : pairs) seconds[next[first]++] = second;
+}
+
+}  // namespace
+
+ControlDependence::ControlDependence(const Cfg& cfg,
+                                     const DominatorTree& post_dominators) {
+  // As in Ferrante, Ottenstein, and Warren: for each edge a -> b where b
+  // doesn't post-dominate a, the blocks from b up the post-dominator tree to
+  // (but not including) a's immediate post-dominator are control dependent on
+  // a. The walks from a's two successors meet on the way up, so each stops at
+  // the first block that the other has already reached.
+  const int num_blocks = cfg.num_blocks();
+  vector<pair<int, int>> dependences;  // (dependent, controller).
+  vector<int> last_controller(num_blocks, -1);
+  for (int a = 0; a < num_blocks; ++a) {
+    if (cfg.successors(a).size() < 2 || !post_dominators.Contains(a)) continue;
+    for (int b : cfg.successors(a)) {
+      if (!post_dominators.Contains(b)) continue;
+      for (int runner = b; runner != post_dominators.idom(a);
+           runner = post_dominators.idom(runner)) {
+        if (last_controller[runner] == a) break;
+        last_controller[runner] = a;
+        dependences.emplace_back(runner, a);
+      }
+    }
+  }
+
+  // The controllers come out in order of id since the pairs are in order of
+  // controller; sorting them back by controller then puts the controlled
+  // blocks in order of id too.
+  GroupByFirst(num_blocks, dependences, controllers_begin_, controllers_);
+  vector<pair<int, int>> controls;  // (controller, dependent).
+  controls.reserve(dependences.size());
+  for (int b = 0; b < num_blocks; ++b) {
+    for (int a : controllers(b)) controls.emplace_back(a, b);
+  }
+  GroupByFirst(num_blocks, controls, controlled_begin_, controlled_);
+}
+
+}  // namespace ir
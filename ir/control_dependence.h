@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ir/cfg.h"
+#include "ir/dominators.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// The control dependence graph of a function: block b is control dependent on
+// block a if a has a successor that b post-dominates, but b doesn't strictly
+// post-dominate a itself. That is, a ends in a $branch that decides whether b
+// runs, and only such blocks control others. A block in a loop can control
+// itself. Blocks that can't reach an exit (see Cfg::Reverse()) neither
+// control nor depend on any block. Usually obtained through
+// Function::control_dependence(), which caches it.
+class ControlDependence {
+ public:
+  // 'post_dominators' must be the dominator tree of cfg.Reverse().
+  ControlDependence(const Cfg& cfg, const DominatorTree& post_dominators);
+
+  // Returns the blocks that a block controls, in order of id.
+  Cfg::Ids controlled(int id) const {
+    return Cfg::Ids(controlled_.data() + controlled_begin_[id],
+                    controlled_.data() + controlled_begin_[id + 1]);
+  }
+
+  // Returns the blocks that a block is control dependent on, in order of id.
+  Cfg::Ids controllers(int id) const {
+    return Cfg::Ids(controllers_.data() + controllers_begin_[id],
+                    controllers_.data() + controllers_begin_[id + 1]);
+  }
+
+ private:
+  // The blocks that block i controls are controlled_[controlled_begin_[i]..
+  // controlled_begin_[i + 1]), and likewise for the blocks that control it.
+  vector<int> controlled_begin_;
+  vector<int> controlled_;
+  vector<int> controllers_begin_;
+  vector<int> controllers_;
+};
+
+}  // namespace ir
@@ -0,0 +1,140 @@
+// Tests for control dependence graphs.
+
+#include "ir/control_dependence.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+
+using namespace ir;
+
+// Returns a function whose block i (block 0 being the entry block) ends in a
+// jump or branch to the blocks in succs[i], or a return if there are none.
+Function MakeFunction(const vector<vector<int>>& succs) {
+  auto label = [](int i) {
+    return i == 0 ? string("entry") : "b" + std::to_string(i);
+  };
+  vector<BasicBlock> blocks;
+  for (size_t i = 0; i < succs.size(); ++i) {
+    Instruction terminator = RetInst(0);
+    if (succs[i].size() == 1) {
+      terminator = JumpInst(label(succs[i][0]));
+    } else if (succs[i].size() == 2) {
+      terminator = BranchInst(0, label(succs[i][0]), label(succs[i][1]));
+    }
+    blocks.emplace_back(label(i), vector<Instruction>{terminator});
+  }
+  return Function("f", Type::Int(), {}, std::move(blocks));
+}
+
+// Returns the labels of the blocks with the given ids.
+vector<string> Labels(const Function& function, Cfg::Ids ids) {
+  vector<string> labels;
+  for (int id : ids) labels.push_back(function.blocks()[id]->label());
+  return labels;
+}
+
+TEST(ControlDependenceTest, Example) {
+  Function foo = Function::FromString(R"""(function foo(p:int) -> int {
+entry:
+  $branch p:int then else
+
+then:
+  $jump join
+
+else:
+  $branch p:int loop spin
+
+loop:
+  $branch p:int loop join
+
+spin:
+  $jump spin
+
+join:
+  $branch p:int ret1 ret2
+
+ret1:
+  $ret 0
+
+ret2:
+  $ret 1
+}
+)""");
+  auto id = [&](const string& label) { return foo[label].id(); };
+  const ControlDependence& cdg = foo.control_dependence();
+
+  EXPECT_EQ(Labels(foo, cdg.controlled(id("entry"))),
+            vector<string>({"then", "else", "loop"}));
+  EXPECT_EQ(Labels(foo, cdg.controlled(id("loop"))),
+            vector<string>({"loop"}));
+  EXPECT_EQ(Labels(foo, cdg.controlled(id("join"))),
+            vector<string>({"ret1", "ret2"}));
+  EXPECT_TRUE(cdg.controlled(id("then")).empty());
+
+  // 'spin' never reaches an exit, so the branch to it decides nothing.
+  EXPECT_TRUE(cdg.controlled(id("else")).empty());
+  EXPECT_TRUE(cdg.controllers(id("spin")).empty());
+
+  EXPECT_EQ(Labels(foo, cdg.controllers(id("loop"))),
+            vector<string>({"entry", "loop"}));
+  EXPECT_EQ(Labels(foo, cdg.controllers(id("then"))),
+            vector<string>({"entry"}));
+  EXPECT_TRUE(cdg.controllers(id("join")).empty());
+  EXPECT_TRUE(cdg.controllers(id("entry")).empty());
+
+  // It's built once.
+  EXPECT_EQ(&foo.control_dependence(), &cdg);
+}
+
+// Checks the graph against the definition on random CFGs.
+TEST(ControlDependenceTest, RandomCfgs) {
+  std::mt19937 random(42);
+  for (int round = 0; round < 200; ++round) {
+    int num_blocks = 1 + random() % 40;
+    vector<vector<int>> succs(num_blocks);
+    for (auto& block_succs : succs) {
+      int num_succs = random() % 3;
+      for (int i = 0; i < num_succs; ++i) {
+        block_succs.push_back(random() % num_blocks);
+      }
+    }
+    Function function = MakeFunction(succs);
+    const Cfg& cfg = function.cfg();
+    const DominatorTree& post_dominators = function.post_dominators();
+    const ControlDependence& cdg = function.control_dependence();
+
+    for (int a = 0; a < num_blocks; ++a) {
+      for (int b = 0; b < num_blocks; ++b) {
+        bool controls = false;
+        if (!post_dominators.StrictlyDominates(b, a)) {
+          for (int succ : cfg.successors(a)) {
+            controls |= post_dominators.Dominates(b, succ);
+          }
+        }
+        auto controlled = cdg.controlled(a);
+        auto controllers = cdg.controllers(b);
+        ASSERT_EQ(std::count(controlled.begin(), controlled.end(), b),
+                  controls)
+            << a << " " << b;
+        ASSERT_EQ(std::count(controllers.begin(), controllers.end(), a),
+                  controls);
+      }
+      ASSERT_TRUE(std::is_sorted(cdg.controlled(a).begin(),
+                                 cdg.controlled(a).end()));
+      ASSERT_TRUE(std::is_sorted(cdg.controllers(a).begin(),
+                                 cdg.controllers(a).end()));
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,231 @@
+#include "ir/dominators.h"
+
+namespace ir {
+
+DominatorTree::DominatorTree(const Cfg& cfg, Algorithm algorithm)
+    : root_(cfg.entry()), idom_(cfg.num_blocks(), -1) {
+  if (root_ >= 0) {
+    switch (algorithm) {
+      case kIterative:
+        ComputeIterative(cfg);
+        break;
+      case kLengauerTarjan:
+        ComputeLengauerTarjan(cfg);
+        break;
+    }
+  }
+  BuildTree();
+}
+
+void DominatorTree::ComputeIterative(const Cfg& cfg) {
+  // Only the blocks processed so far have an idom; the root is temporarily its
+  // own, so that walks up the tree stop there.
+  const auto& rpo = cfg.reverse_postorder();
+  idom_[root_] = root_;
+  const auto intersect = [&](int b1, int b2) {
+    while (b1 != b2) {
+      while (cfg.rpo_number(b1) > cfg.rpo_number(b2)) b1 = idom_[b1];
+      while (cfg.rpo_number(b2) > cfg.rpo_number(b1)) b2 = idom_[b2];
+    }
+    return b1;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i) {
+      int b = rpo[i];
+      int new_idom = -1;
+      for (int pred : cfg.predecessors(b)) {
+        if (idom_[pred] < 0) continue;
+        new_idom = new_idom < 0 ? pred : intersect(pred, new_idom);
+      }
+      if (idom_[b] != new_idom) {
+        idom_[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+  idom_[root_] = -1;
+}
+
+void DominatorTree::ComputeLengauerTarjan(const Cfg& cfg) {
+  // Number the reachable blocks in depth-first preorder; everything below is
+  // indexed by these numbers rather than by block id.
+  const int n = cfg.reverse_postorder().size();
+  vector<int> dfnum(cfg.num_blocks(), -1);
+  vector<int> vertex(n);
+  vector<int> parent(n, -1);
+  int next_dfnum = 0;
+  vector<pair<int, size_t>> stack;  // (block, index of the next successor).
+  dfnum[root_] = next_dfnum;
+  vertex[next_dfnum++] = root_;
+  stack.emplace_back(root_, 0);
+  while (!stack.empty()) {
+    auto& [id, next] = stack.back();
+    Cfg::Ids succs = cfg.successors(id);
+    if (next < succs.size()) {
+      int succ = succs[next++];
+      if (dfnum[succ] < 0) {
+        parent[next_dfnum] = dfnum[id];
+        dfnum[succ] = next_dfnum;
+        vertex[next_dfnum++] = succ;
+        stack.emplace_back(succ, 0);
+      }
+    } else {
+      stack.pop_back();
+    }
+  }
+
+  // The forest of processed vertices, with path compression: 'ancestor' is a
+  // vertex's (compressed) ancestor, or -1 for a root, and 'label' is the
+  // vertex with the smallest semidominator on the compressed path.
+  vector<int> semi(n), ancestor(n, -1), label(n), dom(n, -1);
+  for (int v = 0; v < n; ++v) semi[v] = label[v] = v;
+  vector<int> path;
+  const auto eval = [&](int v) {
+    if (ancestor[v] < 0) return v;
+    // Compress the path from 'v' up to the child of its root, from the top
+    // down.
+    for (int u = v; ancestor[ancestor[u]] >= 0; u = ancestor[u]) {
+      path.push_back(u);
+    }
+    while (!path.empty()) {
+      int u = path.back();
+      path.pop_back();
+      int a = ancestor[u];
+      if (semi[label[a]] < semi[label[u]]) label[u] = label[a];
+      ancestor[u] = ancestor[a];
+    }
+    return label[v];
+  };
+
+  // The vertices whose semidominator is each vertex, as linked lists.
+  vector<int> bucket_head(n, -1), bucket_next(n, -1);
+
+  for (int w = n - 1; w > 0; --w) {
+    for (int pred : cfg.predecessors(vertex[w])) {
+      if (dfnum[pred] < 0) continue;
+      int u = eval(dfnum[pred]);
+      semi[w] = std::min(semi[w], semi[u]);
+    }
+    bucket_next[w] = bucket_head[semi[w]];
+    bucket_head[semi[w]] = w;
+    int p = parent[w];
+    ancestor[w] = p;
+    for (int v = bucket_head[p]; v >= 0; v = bucket_next[v]) {
+      int u = eval(v);
+      dom[v] = semi[u] < semi[v] ? u : p;
+    }
+    bucket_head[p] = -1;
+  }
+  for (int w = 1; w < n; ++w) {
+    if (dom[w] != semi[w]) dom[w] = dom[dom[w]];
+    idom_[vertex[w]] = vertex[dom[w]];
+  }
+}
+
+void DominatorTree::BuildTree() {
+  const int num_blocks = idom_.size();
+
+  // The children, by counting sort on the idoms, so that they come out in
+  // order of id.
+  children_begin_.assign(num_blocks + 1, 0);
+  for (int idom : idom_) {
+    if (idom >= 0) ++children_begin_[idom + 1];
+  }
+  for (int i = 0; i < num_blocks; ++i) {
+    children_begin_[i + 1] += children_begin_[i];
+  }
+  children_.resize(children_begin_[num_blocks]);
+  vector<int> next_child(children_begin_.begin(), children_begin_.end() - 1);
+  for (int i = 0; i < num_blocks; ++i) {
+    if (idom_[i] >= 0) children_[next_child[idom_[i]]++] = i;
+  }
+
+  // The preorder and postorder numbers, by a depth-first walk of the tree with
+  // an explicit stack of (block, index of the next child to visit).
+  pre_.assign(num_blocks, -1);
+  post_.assign(num_blocks, -1);
+  if (root_ < 0) return;
+  int next_pre = 0, next_post = 0;
+  vector<pair<int, size_t>> stack;
+  pre_[root_] = next_pre++;
+  stack.emplace_back(root_, 0);
+  while (!stack.empty()) {
+    auto& [id, next] = stack.back();
+    Cfg::Ids kids = children(id);
+    if (next < kids.size()) {
+      int child = kids[next++];
+      pre_[child] = next_pre++;
+      stack.emplace_back(child, 0);
+    } else {
+      post_[id] = next_post++;
+      stack.pop_back();
+    }
+  }
+}
+
+DominanceFrontier::DominanceFrontier(const Cfg& cfg,
+                                     const DominatorTree& dominators) {
+  // As in Cooper, Harvey, and Kennedy: a block b is in the frontier of each
+  // block on the way up the tree from each of its predecessors to its idom
+  // (which is none of them if b has a single predecessor, unless b is the
+  // entry block). Collect these (block, b) pairs in order of b and then sort
+  // them by block, so that each frontier comes out in order of id.
+  const int num_blocks = cfg.num_blocks();
+  vector<pair<int, int>> pairs;
+  vector<int> last_added(num_blocks, -1);
+  for (int b = 0; b < num_blocks; ++b) {
+    if (!cfg.IsReachable(b)) continue;
+    for (int pred : cfg.predecessors(b)) {
+      if (!cfg.IsReachable(pred)) continue;
+      for (int runner = pred; runner != dominators.idom(b);
+           runner = dominators.idom(runner)) {
+        if (last_added[runner] == b) break;
+        last_added[runner] = b;
+        pairs.emplace_back(runner, b);
+      }
+    }
+  }
+
+  frontier_begin_.assign(num_blocks + 1, 0);
+  for (const auto& [block, b] : pairs) ++frontier_begin_[block + 1];
+  for (int i = 0; i < num_blocks; ++i) {
+    frontier_begin_[i + 1] += frontier_begin_[i];
+  }
+  frontier_.resize(pairs.size());
+  vector<int> next(frontier_begin_.begin(), frontier_begin_.end() - 1);
+  for (const auto& [block, b] : pairs) frontier_[next[block]++] = b;
+}
+
+vector<int> DominanceFrontier::Iterated(const vector<int>& ids) const {
+  const int num_blocks = frontier_begin_.size() - 1;
+  vector<char> in_result(num_blocks, false), queued(num_blocks, false);
+  vector<int> worklist;
+  for (int id : ids) {
+    if (!queued[id]) {
+      queued[id] = true;
+      worklist.push_back(id);
+    }
+  }
+
+  vector<int> result;
+  while (!worklist.empty()) {
+    int id = worklist.back();
+    worklist.pop_back();
+    for (int b : (*this)[id]) {
+      if (in_result[b]) continue;
+      in_result[b] = true;
+      result.push_back(b);
+      if (!queued[b]) {
+        queued[b] = true;
+        worklist.push_back(b);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+}  // namespace ir
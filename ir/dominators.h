@@ -0,0 +1,115 @@
+#pragma once
+
+#include "ir/cfg.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// The dominator tree of a CFG: block a dominates block b if every path from
+// the entry block to b goes through a, and the immediate dominator of b is the
+// closest of the blocks that strictly dominate it. Blocks that aren't
+// reachable from the entry block aren't in the tree: they neither dominate nor
+// are dominated by any block. Usually obtained through Function::dominators(),
+// which caches it.
+//
+// The dominator tree of the reverse CFG (see Cfg::Reverse()) is the
+// post-dominator tree: a post-dominates b if every path from b to an exit goes
+// through a. See Function::post_dominators().
+class DominatorTree {
+ public:
+  enum Algorithm {
+    // Cooper, Harvey, and Kennedy's "A Simple, Fast Dominance Algorithm",
+    // which iterates over the reverse postorder until the immediate
+    // dominators settle. Usually the fastest, since most CFGs settle in two
+    // or three passes.
+    kIterative,
+    // Lengauer and Tarjan's algorithm (the simple version, with path
+    // compression), which takes O(E log V) time whatever the shape of the
+    // CFG, so it suits huge functions where the iterative algorithm needs many
+    // passes or long walks up the tree.
+    kLengauerTarjan,
+  };
+
+  explicit DominatorTree(const Cfg& cfg, Algorithm algorithm = kIterative);
+
+  int num_blocks() const { return idom_.size(); }
+
+  // Returns the root of the tree (the CFG's entry block), or -1 if there is
+  // none.
+  int root() const { return root_; }
+
+  // Returns the immediate dominator of a block, or -1 for the root and
+  // unreachable blocks.
+  int idom(int id) const { return idom_[id]; }
+
+  // Returns whether a block is in the tree (i.e., is reachable from the root).
+  bool Contains(int id) const { return pre_[id] >= 0; }
+
+  // Returns the blocks that a block immediately dominates, in order of id.
+  Cfg::Ids children(int id) const {
+    return Cfg::Ids(children_.data() + children_begin_[id],
+                    children_.data() + children_begin_[id + 1]);
+  }
+
+  // Returns whether a dominates b (every block dominates itself), in constant
+  // time by comparing the blocks' preorder and postorder numbers in the tree.
+  bool Dominates(int a, int b) const {
+    return pre_[a] >= 0 && pre_[b] >= 0 && pre_[a] <= pre_[b] &&
+           post_[b] <= post_[a];
+  }
+
+  bool StrictlyDominates(int a, int b) const {
+    return a != b && Dominates(a, b);
+  }
+
+ private:
+  // Fill in 'idom_' for the blocks reachable from the root.
+  void ComputeIterative(const Cfg& cfg);
+  void ComputeLengauerTarjan(const Cfg& cfg);
+
+  // Fills in the children and the preorder and postorder numbers from
+  // 'idom_'.
+  void BuildTree();
+
+  int root_;
+  vector<int> idom_;
+
+  // The children of block i are children_[children_begin_[i]..
+  // children_begin_[i + 1]).
+  vector<int> children_begin_;
+  vector<int> children_;
+
+  // The preorder and postorder numbers of the blocks in the tree (-1 for
+  // unreachable blocks).
+  vector<int> pre_;
+  vector<int> post_;
+};
+
+// The dominance frontiers of the blocks of a CFG: the frontier of block a is
+// the set of blocks where a's dominance ends, i.e., the blocks that a doesn't
+// strictly dominate but that have a predecessor that a dominates. SSA
+// construction places the phis for a variable at the iterated dominance
+// frontier of the blocks that assign it.
+class DominanceFrontier {
+ public:
+  DominanceFrontier(const Cfg& cfg, const DominatorTree& dominators);
+
+  // Returns the dominance frontier of a block, in order of id.
+  Cfg::Ids operator[](int id) const {
+    return Cfg::Ids(frontier_.data() + frontier_begin_[id],
+                    frontier_.data() + frontier_begin_[id + 1]);
+  }
+
+  // Returns the iterated dominance frontier of a set of blocks (i.e., the
+  // limit of adding the frontiers of the blocks in the set and of the blocks
+  // added so far), in order of id.
+  vector<int> Iterated(const vector<int>& ids) const;
+
+ private:
+  // The frontier of block i is frontier_[frontier_begin_[i]..
+  // frontier_begin_[i + 1]).
+  vector<int> frontier_begin_;
+  vector<int> frontier_;
+};
+
+}  // namespace ir
@@ -0,0 +1,108 @@
+// Measures building dominator trees and dominance frontiers of large generated
+// CFGs.
+
+#include <benchmark/benchmark.h>
+
+#include "ir/dominators.h"
+
+namespace {
+
+using namespace ir;
+
+// Returns a function whose block i (block 0 being the entry block) ends in a
+// jump or branch to the blocks in succs[i], or a return if there are none.
+Function MakeFunction(const vector<vector<int>>& succs) {
+  auto label = [](int i) {
+    return i == 0 ? string("entry") : "b" + std::to_string(i);
+  };
+  vector<BasicBlock> blocks;
+  blocks.reserve(succs.size());
+  for (size_t i = 0; i < succs.size(); ++i) {
+    Instruction terminator = RetInst(0);
+    if (succs[i].size() == 1) {
+      terminator = JumpInst(label(succs[i][0]));
+    } else if (succs[i].size() == 2) {
+      terminator = BranchInst(0, label(succs[i][0]), label(succs[i][1]));
+    }
+    blocks.emplace_back(label(i), vector<Instruction>{terminator});
+  }
+  return Function("f", Type::Int(), {}, std::move(blocks));
+}
+
+// Returns a deep CFG of 'num_blocks' blocks: a chain in which each block also
+// loops back to the block 8 before it, so the dominator tree is a path and
+// every block is in 8 overlapping loops.
+Function MakeDeepFunction(int num_blocks) {
+  vector<vector<int>> succs(num_blocks);
+  for (int i = 0; i + 1 < num_blocks; ++i) {
+    succs[i] = {i + 1, std::max(i - 8, 0)};
+  }
+  return MakeFunction(succs);
+}
+
+// Returns a wide CFG of 'num_blocks' blocks: a binary tree of branches whose
+// leaves all jump to a single exit block, so the dominator tree is shallow
+// and the exit block has half of the blocks as predecessors.
+Function MakeWideFunction(int num_blocks) {
+  vector<vector<int>> succs(num_blocks);
+  int exit = num_blocks - 1;
+  for (int i = 0; i < exit; ++i) {
+    if (2 * i + 2 < exit) {
+      succs[i] = {2 * i + 1, 2 * i + 2};
+    } else {
+      succs[i] = {exit};
+    }
+  }
+  return MakeFunction(succs);
+}
+
+// Builds the dominator tree of a function of range(0) blocks with algorithm
+// range(1).
+template <Function (*MakeFunction)(int)>
+void BM_DominatorTree(benchmark::State& state) {
+  Function function = MakeFunction(state.range(0));
+  const Cfg& cfg = function.cfg();
+  auto algorithm = static_cast<DominatorTree::Algorithm>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DominatorTree(cfg, algorithm));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_DominatorTree, MakeDeepFunction)
+    ->ArgsProduct({{1 << 10, 1 << 14, 1 << 18},
+                   {DominatorTree::kIterative, DominatorTree::kLengauerTarjan}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DominatorTree, MakeWideFunction)
+    ->ArgsProduct({{1 << 10, 1 << 14, 1 << 18},
+                   {DominatorTree::kIterative, DominatorTree::kLengauerTarjan}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Builds the dominance frontiers of a function of range(0) blocks and the
+// iterated frontier of one block in every 16.
+template <Function (*MakeFunction)(int)>
+void BM_DominanceFrontier(benchmark::State& state) {
+  Function function = MakeFunction(state.range(0));
+  const Cfg& cfg = function.cfg();
+  const DominatorTree& dominators = function.dominators();
+  vector<int> defs;
+  for (int i = 0; i < state.range(0); i += 16) defs.push_back(i);
+  for (auto _ : state) {
+    DominanceFrontier frontier(cfg, dominators);
+    benchmark::DoNotOptimize(frontier.Iterated(defs));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_DominanceFrontier, MakeDeepFunction)
+    ->Arg(1 << 10)
+    ->Arg(1 << 14)
+    ->Arg(1 << 18)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DominanceFrontier, MakeWideFunction)
+    ->Arg(1 << 10)
+    ->Arg(1 << 14)
+    ->Arg(1 << 18)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
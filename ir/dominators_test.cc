@@ -0,0 +1,245 @@
+// Tests for dominator trees and dominance frontiers.
+
+#include "ir/dominators.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+
+using namespace ir;
+
+constexpr DominatorTree::Algorithm kAlgorithms[] = {
+    DominatorTree::kIterative, DominatorTree::kLengauerTarjan};
+
+// Returns a function whose block i (block 0 being the entry block) ends in a
+// jump or branch to the blocks in succs[i], or a return if there are none.
+Function MakeFunction(const vector<vector<int>>& succs) {
+  auto label = [](int i) {
+    return i == 0 ? string("entry") : "b" + std::to_string(i);
+  };
+  vector<BasicBlock> blocks;
+  for (size_t i = 0; i < succs.size(); ++i) {
+    Instruction terminator = RetInst(0);
+    if (succs[i].size() == 1) {
+      terminator = JumpInst(label(succs[i][0]));
+    } else if (succs[i].size() == 2) {
+      terminator = BranchInst(0, label(succs[i][0]), label(succs[i][1]));
+    }
+    blocks.emplace_back(label(i), vector<Instruction>{terminator});
+  }
+  return Function("f", Type::Int(), {}, std::move(blocks));
+}
+
+// Returns the labels of the blocks with the given ids.
+vector<string> Labels(const Function& function, const vector<int>& ids) {
+  vector<string> labels;
+  for (int id : ids) labels.push_back(function.blocks()[id]->label());
+  return labels;
+}
+
+vector<string> Labels(const Function& function, Cfg::Ids ids) {
+  return Labels(function, vector<int>(ids.begin(), ids.end()));
+}
+
+const char kFunction[] = R"""(function foo(p:int) -> int {
+entry:
+  $branch p:int a b
+
+a:
+  $jump c
+
+b:
+  $branch p:int c d
+
+c:
+  $jump e
+
+d:
+  $jump e
+
+e:
+  $branch p:int b exit
+
+exit:
+  $ret 0
+
+dead:
+  $jump e
+}
+)""";
+
+TEST(DominatorTreeTest, Example) {
+  Function foo = Function::FromString(kFunction);
+  auto id = [&](const string& label) { return foo[label].id(); };
+  for (auto algorithm : kAlgorithms) {
+    DominatorTree dominators(foo.cfg(), algorithm);
+    EXPECT_EQ(dominators.root(), id("entry"));
+    EXPECT_EQ(dominators.idom(id("entry")), -1);
+    EXPECT_EQ(dominators.idom(id("a")), id("entry"));
+    EXPECT_EQ(dominators.idom(id("b")), id("entry"));
+    EXPECT_EQ(dominators.idom(id("c")), id("entry"));
+    EXPECT_EQ(dominators.idom(id("d")), id("b"));
+    EXPECT_EQ(dominators.idom(id("e")), id("entry"));
+    EXPECT_EQ(dominators.idom(id("exit")), id("e"));
+    EXPECT_EQ(dominators.idom(id("dead")), -1);
+    EXPECT_EQ(Labels(foo, dominators.children(id("entry"))),
+              vector<string>({"a", "b", "c", "e"}));
+
+    EXPECT_TRUE(dominators.Dominates(id("entry"), id("exit")));
+    EXPECT_TRUE(dominators.Dominates(id("b"), id("d")));
+    EXPECT_TRUE(dominators.Dominates(id("d"), id("d")));
+    EXPECT_FALSE(dominators.StrictlyDominates(id("d"), id("d")));
+    EXPECT_FALSE(dominators.Dominates(id("b"), id("e")));
+    EXPECT_FALSE(dominators.Dominates(id("d"), id("b")));
+
+    // Unreachable blocks are outside the tree.
+    EXPECT_FALSE(dominators.Dominates(id("dead"), id("dead")));
+    EXPECT_FALSE(dominators.Dominates(id("dead"), id("e")));
+    EXPECT_FALSE(dominators.Dominates(id("entry"), id("dead")));
+  }
+}
+
+TEST(DominanceFrontierTest, Example) {
+  Function foo = Function::FromString(kFunction);
+  auto id = [&](const string& label) { return foo[label].id(); };
+  DominanceFrontier frontier(foo.cfg(), foo.dominators());
+  EXPECT_TRUE(frontier[id("entry")].empty());
+  EXPECT_EQ(Labels(foo, frontier[id("a")]), vector<string>({"c"}));
+  EXPECT_EQ(Labels(foo, frontier[id("b")]), vector<string>({"c", "e"}));
+  EXPECT_EQ(Labels(foo, frontier[id("c")]), vector<string>({"e"}));
+  EXPECT_EQ(Labels(foo, frontier[id("d")]), vector<string>({"e"}));
+  EXPECT_EQ(Labels(foo, frontier[id("e")]), vector<string>({"b"}));
+  EXPECT_TRUE(frontier[id("exit")].empty());
+  EXPECT_TRUE(frontier[id("dead")].empty());
+
+  EXPECT_EQ(Labels(foo, frontier.Iterated({id("d")})),
+            vector<string>({"b", "c", "e"}));
+  EXPECT_EQ(Labels(foo, frontier.Iterated({id("exit"), id("a")})),
+            vector<string>({"b", "c", "e"}));
+  EXPECT_TRUE(frontier.Iterated({id("entry")}).empty());
+}
+
+TEST(DominatorTreeTest, PostDominators) {
+  Function foo = Function::FromString(kFunction);
+  auto id = [&](const string& label) { return foo[label].id(); };
+  const DominatorTree& post_dominators = foo.post_dominators();
+  EXPECT_EQ(post_dominators.root(), id("exit"));
+  EXPECT_EQ(post_dominators.idom(id("entry")), id("e"));
+  EXPECT_EQ(post_dominators.idom(id("a")), id("c"));
+  EXPECT_EQ(post_dominators.idom(id("b")), id("e"));
+  EXPECT_EQ(post_dominators.idom(id("c")), id("e"));
+  EXPECT_EQ(post_dominators.idom(id("d")), id("e"));
+  EXPECT_EQ(post_dominators.idom(id("e")), id("exit"));
+  EXPECT_EQ(post_dominators.idom(id("dead")), id("e"));
+  EXPECT_TRUE(post_dominators.Dominates(id("e"), id("entry")));
+  EXPECT_FALSE(post_dominators.Dominates(id("c"), id("b")));
+  EXPECT_EQ(&foo.post_dominators(), &post_dominators);
+}
+
+// Checks both algorithms and the frontiers against the definitions on random
+// CFGs.
+TEST(DominatorTreeTest, RandomCfgs) {
+  std::mt19937 random(42);
+  for (int round = 0; round < 200; ++round) {
+    int num_blocks = 1 + random() % 40;
+    vector<vector<int>> succs(num_blocks);
+    for (auto& block_succs : succs) {
+      int num_succs = random() % 3;
+      for (int i = 0; i < num_succs; ++i) {
+        block_succs.push_back(random() % num_blocks);
+      }
+    }
+    Function function = MakeFunction(succs);
+    const Cfg& cfg = function.cfg();
+
+    // a dominates b iff b is unreachable from the entry block without going
+    // through a.
+    auto reachable_without = [&](int a) {
+      vector<char> reached(num_blocks, false);
+      vector<int> worklist;
+      if (a != 0) {
+        reached[0] = true;
+        worklist.push_back(0);
+      }
+      while (!worklist.empty()) {
+        int id = worklist.back();
+        worklist.pop_back();
+        for (int succ : cfg.successors(id)) {
+          if (succ != a && !reached[succ]) {
+            reached[succ] = true;
+            worklist.push_back(succ);
+          }
+        }
+      }
+      return reached;
+    };
+
+    DominatorTree iterative(cfg, DominatorTree::kIterative);
+    DominatorTree lengauer_tarjan(cfg, DominatorTree::kLengauerTarjan);
+    for (int a = 0; a < num_blocks; ++a) {
+      ASSERT_EQ(iterative.idom(a), lengauer_tarjan.idom(a));
+      vector<char> reached = reachable_without(a);
+      for (int b = 0; b < num_blocks; ++b) {
+        bool dominates =
+            cfg.IsReachable(a) && cfg.IsReachable(b) && !reached[b];
+        ASSERT_EQ(iterative.Dominates(a, b), dominates) << a << " " << b;
+        ASSERT_EQ(lengauer_tarjan.Dominates(a, b), dominates);
+      }
+    }
+
+    DominanceFrontier frontier(cfg, iterative);
+    for (int a = 0; a < num_blocks; ++a) {
+      vector<int> expected;
+      for (int b = 0; b < num_blocks; ++b) {
+        if (!cfg.IsReachable(b) || iterative.StrictlyDominates(a, b)) {
+          continue;
+        }
+        for (int pred : cfg.predecessors(b)) {
+          if (iterative.Dominates(a, pred)) {
+            expected.push_back(b);
+            break;
+          }
+        }
+      }
+      ASSERT_EQ(vector<int>(frontier[a].begin(), frontier[a].end()),
+                expected);
+    }
+  }
+}
+
+// Deep trees must not overflow the stack.
+TEST(DominatorTreeTest, DeepCfg) {
+  constexpr int kNumBlocks = 200000;
+  vector<vector<int>> succs(kNumBlocks);
+  for (int i = 0; i + 1 < kNumBlocks; ++i) succs[i] = {i + 1, 0};
+  Function function = MakeFunction(succs);
+  for (auto algorithm : kAlgorithms) {
+    DominatorTree dominators(function.cfg(), algorithm);
+    for (int i = 1; i < kNumBlocks; ++i) {
+      ASSERT_EQ(dominators.idom(i), i - 1);
+    }
+    EXPECT_TRUE(dominators.Dominates(1, kNumBlocks - 1));
+    EXPECT_FALSE(dominators.Dominates(kNumBlocks - 1, 1));
+  }
+  DominanceFrontier frontier(function.cfg(), function.dominators());
+  EXPECT_EQ(frontier.Iterated({kNumBlocks - 2}), vector<int>({0}));
+}
+
+TEST(DominatorTreeTest, Cached) {
+  Function foo = Function::FromString(kFunction);
+  const DominatorTree* dominators = &foo.dominators();
+  EXPECT_EQ(&foo.dominators(), dominators);
+  Function moved = std::move(foo);
+  EXPECT_EQ(&moved.dominators(), dominators);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -1,15 +1,68 @@
 #include "ir/ir.h"
 
+#include <atomic>
+#include <charconv>
+#include <mutex>
+#include <numeric>
+#include <shared_mutex>
+#include <thread>
+
+#include "ir/cfg.h"
+#include "ir/compact_code.h"
+#include "ir/control_dependence.h"
+#include "ir/dominators.h"
+#include "ir/text_image.h"
 #include "ir_tostring_visitor.h"
-#include "util/tokenizer.h"
+#include "util/buffered_writer.h"
+#include "util/lexer.h"
+#include "util/mapped_file.h"
 
 namespace ir {
 
+// The global variables (function pointers and null pointers) of a program
+// being parsed by several FromStringHelpers at once, so that each global is
+// still represented by a single VarPtr_t. Thread-safe.
+class SharedGlobals {
+ public:
+  // Returns the variable already recorded for the same global as 'var' (i.e.,
+  // the same null pointer type or the same function name) if there is one,
+  // otherwise records and returns 'var'.
+  VarPtr_t Intern(VarPtr_t var) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (var->name() == "@nullptr") {
+      return null_vars_.emplace(var->type(), var).first->second;
+    }
+    return func_vars_.emplace(var->name(), var).first->second;
+  }
+
+ private:
+  std::mutex mutex_;
+  unordered_map<string, VarPtr_t> func_vars_;
+  unordered_map<Type, VarPtr_t> null_vars_;
+};
+
 namespace {  // Helpers for *::FromString().
 
-Type ReadType(util::Tokenizer& tk) {
+// The lexer specs are built once and shared by all parses.
+const shared_ptr<const util::LexerSpec>& IrLexerSpec() {
+  static const auto spec = make_shared<const util::LexerSpec>(
+      set<char>{' ', '\n'},
+      set<string>{":", ",", "=", "->", "*", "[", "]", "{", "}", "(", ")"},
+      set<string>{"$arith", "$cmp", "$phi", "$alloc", "$addrof", "$load",
+                  "$store", "$gep", "$select", "$call", "$icall", "$ret",
+                  "$jump", "$branch"});
+  return spec;
+}
+
+const shared_ptr<const util::LexerSpec>& TypeLexerSpec() {
+  static const auto spec = make_shared<const util::LexerSpec>(
+      set<char>{}, set<string>{"[", "]", ",", "*"}, set<string>{});
+  return spec;
+}
+
+Type ReadType(util::Lexer& tk) {
   vector<Type> types;
-  string type_str = tk.ConsumeToken();
+  string type_str(tk.ConsumeToken());
 
   Type type = (type_str == "int") ? Type::Int() : Type::Struct(type_str);
   while (tk.QueryConsume("*")) type = type.PtrTo();
@@ -29,10 +82,47 @@ Type ReadType(util::Tokenizer& tk) {
   return type;
 }
 
+// Thrown for malformed input by a FromStringHelper that is collecting errors
+// rather than FATALing.
+struct ParseError {
+  string message;
+};
+
 class FromStringHelper {
  public:
-  FromStringHelper(const string& str)
-      : tk_(str, whitespace_, delimiters_, reserved_) {}
+  // 'first_line' is the line number on which 'str' starts, if it is part of a
+  // larger text. If 'shared_globals' is non-null then global variables are
+  // shared with the other helpers using it.
+  explicit FromStringHelper(std::string_view str, int first_line = 1,
+                            SharedGlobals* shared_globals = nullptr)
+      : tk_(str, IrLexerSpec(), first_line), shared_globals_(shared_globals) {}
+
+  // Starts reading from a new input (e.g., the next part of a larger text),
+  // remembering the global variables seen so far.
+  void SetInput(std::string_view str, int first_line) {
+    tk_ = util::Lexer(str, IrLexerSpec(), first_line);
+    if (throw_errors_) tk_.SetErrorHandler(ThrowParseError);
+  }
+
+  // Makes the helper allocate the variables it reads in 'arena', which then
+  // owns them (see ParseOptions::use_arena).
+  void UseArena(util::Arena* arena) { arena_ = arena; }
+
+  // Makes malformed input throw a ParseError instead of FATALing.
+  void ThrowErrors() {
+    throw_errors_ = true;
+    tk_.SetErrorHandler(ThrowParseError);
+  }
+
+  // Returns whether the next thing in the input is a struct type definition.
+  bool AtStructType() { return tk_.QueryNoConsume("struct"); }
+
+  // Reports an error if there is anything left in the input.
+  void CheckEndOfInput() {
+    if (!tk_.EndOfInput()) {
+      tk_.Error("unexpected token "s + string(tk_.Peek(0)));
+    }
+  }
 
   Instruction ReadInstruction() {
     // Convert string into ArithInst::Aop.
@@ -52,48 +142,55 @@ class FromStringHelper {
 
     // Read and return a variable.
     auto read_var = [&]() {
-      string name = tk_.ConsumeToken();
+      string name(tk_.ConsumeToken());
       tk_.Consume(":");
       Type type = ReadType(tk_);
 
       if (name == "@nullptr") {
-        if (!null_vars_.count(type)) {
-          null_vars_[type] = make_shared<const Variable>(name, type);
-        }
+        if (!null_vars_.count(type)) null_vars_[type] = NewGlobal(name, type);
         return null_vars_.at(type);
       } else if (name[0] == '@') {
-        if (!func_vars_.count(name)) {
-          func_vars_[name] = make_shared<const Variable>(name, type);
-        } else {
-          CHECK_EQ(func_vars_.at(name)->type(), type)
-              << "Global function pointers with same name but different types: "
-              << name << " with types " << func_vars_.at(name)->type()
-              << " and " << type;
+        if (!func_vars_.count(name)) func_vars_[name] = NewGlobal(name, type);
+        if (func_vars_.at(name)->type() != type) {
+          tk_.Error(
+              "Global function pointers with same name but different types: " +
+              name + " with types " + func_vars_.at(name)->type().ToString() +
+              " and " + type.ToString());
         }
         return func_vars_.at(name);
       } else if (!vars_.count(name)) {
-        vars_[name] = make_shared<const Variable>(name, type);
-      } else {
-        CHECK_EQ(vars_.at(name)->type(), type)
-            << "Local variables with same name but different types: " << name
-            << " with types " << vars_.at(name)->type() << " and " << type;
+        vars_[name] = NewLocal(name, type);
+      } else if (vars_.at(name)->type() != type) {
+        tk_.Error("Local variables with same name but different types: " +
+                  name + " with types " + vars_.at(name)->type().ToString() +
+                  " and " + type.ToString());
       }
       return vars_.at(name);
     };
 
     // Read and return an operand (a variable or an integer constant).
     auto read_op = [&]() {
-      string token = tk_.ConsumeToken();
-      if (token.find_first_not_of("-0123456789") == string::npos) {
+      std::string_view token = tk_.Peek(0);
+      if (!token.empty() &&
+          token.find_first_not_of("-0123456789") == string::npos) {
         // Token is an integer constant.
-        return Operand(stoi(token));
+        token = tk_.ConsumeToken();
+        int value = 0;
+        auto [end, err] =
+            std::from_chars(token.data(), token.data() + token.size(), value);
+        if (err != std::errc() || end != token.data() + token.size()) {
+          tk_.Error("malformed integer constant: " + string(token));
+        }
+        return Operand(value);
       } else {
         // Token is the name of a variable.
-        tk_.Put(token);
         return Operand(read_var());
       }
     };
 
+    // Read a label (e.g., the target of a jump or branch).
+    auto read_label = [&]() { return string(tk_.ConsumeToken()); };
+
     // Read a set of comma-delimited operands inside parentheses.
     auto read_args = [&]() {
       vector<Operand> ops;
@@ -105,13 +202,21 @@ class FromStringHelper {
       return ops;
     };
 
-    // Figure out what kind of instruction this is.
+    // Figure out what kind of instruction this is. Note that the operands of
+    // an instruction must be read in order, so they are read into local
+    // variables first (the evaluation order of constructor arguments is
+    // unspecified).
     if (tk_.QueryConsume("$store")) {
-      return StoreInst(read_var(), read_op());
+      auto dst = read_var();
+      auto value = read_op();
+      return StoreInst(dst, value);
     } else if (tk_.QueryConsume("$jump")) {
-      return JumpInst(tk_.ConsumeToken());
+      return JumpInst(read_label());
     } else if (tk_.QueryConsume("$branch")) {
-      return BranchInst(read_op(), tk_.ConsumeToken(), tk_.ConsumeToken());
+      auto condition = read_op();
+      auto label_true = read_label();
+      auto label_false = read_label();
+      return BranchInst(condition, label_true, label_false);
     } else if (tk_.QueryConsume("$ret")) {
       return RetInst(read_op());
     } else {
@@ -120,15 +225,23 @@ class FromStringHelper {
       tk_.Consume("=");
 
       if (tk_.QueryConsume("$arith")) {
-        string op = tk_.ConsumeToken();
-        CHECK(str_to_aop.count(op)) << "unknown arithmetic operation";
+        string op(tk_.ConsumeToken());
+        if (!str_to_aop.count(op)) {
+          tk_.Error("unknown arithmetic operation: " + op);
+        }
         auto aop = str_to_aop.at(op);
-        return ArithInst(lhs, read_op(), read_op(), aop);
+        auto op1 = read_op();
+        auto op2 = read_op();
+        return ArithInst(lhs, op1, op2, aop);
       } else if (tk_.QueryConsume("$cmp")) {
-        string op = tk_.ConsumeToken();
-        CHECK(str_to_rop.count(op)) << "unknown comparison operation";
+        string op(tk_.ConsumeToken());
+        if (!str_to_rop.count(op)) {
+          tk_.Error("unknown comparison operation: " + op);
+        }
         auto rop = str_to_rop.at(op);
-        return CmpInst(lhs, read_op(), read_op(), rop);
+        auto op1 = read_op();
+        auto op2 = read_op();
+        return CmpInst(lhs, op1, op2, rop);
       } else if (tk_.QueryConsume("$phi")) {
         return PhiInst(lhs, read_args());
       } else if (tk_.QueryConsume("$copy")) {
@@ -149,20 +262,25 @@ class FromStringHelper {
         }
         return GepInst(lhs, var, op, field);
       } else if (tk_.QueryConsume("$select")) {
-        return SelectInst(lhs, read_op(), read_op(), read_op());
+        auto condition = read_op();
+        auto true_op = read_op();
+        auto false_op = read_op();
+        return SelectInst(lhs, condition, true_op, false_op);
       } else if (tk_.QueryConsume("$call")) {
-        return CallInst(lhs, tk_.ConsumeToken(), read_args());
+        string callee(tk_.ConsumeToken());
+        return CallInst(lhs, callee, read_args());
       } else if (tk_.QueryConsume("$icall")) {
-        return ICallInst(lhs, read_var(), read_args());
+        auto func_ptr = read_var();
+        return ICallInst(lhs, func_ptr, read_args());
       }
     }
 
-    LOG(FATAL) << "Unknown opcode: " << tk_.ConsumeToken();
+    tk_.Error("unknown opcode: " + string(tk_.Peek(0)));
   }
 
   BasicBlock ReadBasicBlock() {
     // Parse basic block.
-    string label = tk_.ConsumeToken();
+    string label(tk_.ConsumeToken());
     tk_.Consume(":");
 
     vector<Instruction> bb_body;
@@ -177,7 +295,29 @@ class FromStringHelper {
       }
     }
 
-    return BasicBlock(label, bb_body);
+    return BasicBlock(label, std::move(bb_body));
+  }
+
+  // Reads just the header of a function definition (i.e., up to its body);
+  // returns the function's name and type.
+  pair<string, Type> ReadFunctionHeader() {
+    tk_.Consume("function");
+    string fun_name(tk_.ConsumeToken());
+
+    // The return type followed by the parameter types.
+    vector<Type> types(1);
+
+    tk_.Consume("(");
+    while (!tk_.QueryConsume(")")) {
+      tk_.ConsumeToken();
+      tk_.Consume(":");
+      types.push_back(ReadType(tk_));
+      if (!tk_.QueryNoConsume(")")) tk_.Consume(",");
+    }
+
+    tk_.Consume("->");
+    types[0] = ReadType(tk_);
+    return {fun_name, Type::Function(types)};
   }
 
   Function ReadFunction() {
@@ -185,7 +325,7 @@ class FromStringHelper {
     vars_.clear();
 
     tk_.Consume("function");
-    string fun_name = tk_.ConsumeToken();
+    string fun_name(tk_.ConsumeToken());
 
     // Function parameters.
     vector<VarPtr_t> params;
@@ -193,9 +333,9 @@ class FromStringHelper {
     // Parse function parameters.
     tk_.Consume("(");
     while (!tk_.QueryConsume(")")) {
-      string param_name = tk_.ConsumeToken();
+      string param_name(tk_.ConsumeToken());
       tk_.Consume(":");
-      auto param = make_shared<const Variable>(param_name, ReadType(tk_));
+      auto param = NewLocal(param_name, ReadType(tk_));
       params.push_back(param);
       vars_[param_name] = param;
       if (!tk_.QueryNoConsume(")")) tk_.Consume(",");
@@ -204,85 +344,358 @@ class FromStringHelper {
     tk_.Consume("->");
     Type fun_rettype = ReadType(tk_);
 
-    // Function basic blocks.
+    // Function basic blocks, and their labels.
     vector<BasicBlock> fun_body;
+    set<string> labels;
 
     // Parse function body.
     tk_.Consume("{");
     while (!tk_.QueryConsume("}")) {
-      BasicBlock bb = ReadBasicBlock();
-      fun_body.emplace_back(bb);
+      if (!labels.insert(string(tk_.Peek(0))).second) {
+        tk_.Error("duplicate basic block label: " + string(tk_.Peek(0)));
+      }
+      fun_body.push_back(ReadBasicBlock());
     }
+    if (fun_body.empty()) tk_.Error("function body must be non-empty");
 
-    return Function(fun_name, fun_rettype, params, fun_body);
+    return Function(fun_name, fun_rettype, params, std::move(fun_body));
   }
 
-  Program ReadProgram() {
-    // Program struct types, keyed by name.
-    map<string, map<string, Type>> struct_types;
-
-    // Parse struct type definitions.
-    while (tk_.QueryConsume("struct")) {
-      string name = tk_.ConsumeToken();
-
-      CHECK_EQ(struct_types.count(name), 0)
-          << "Two structs with same name: " << name;
+  // Reads a struct type definition and adds it to 'struct_types'.
+  void ReadStructType(map<string, map<string, Type>>& struct_types) {
+    tk_.Consume("struct");
+    string name(tk_.ConsumeToken());
 
-      tk_.Consume("{");
-      while (!tk_.QueryConsume("}")) {
-        string field = tk_.ConsumeToken();
+    if (struct_types.count(name)) {
+      tk_.Error("Two structs with same name: " + name);
+    }
 
-        CHECK(!struct_types.count(name) || !struct_types.at(name).count(field))
-            << "Two fields of same struct with same name: " << field;
+    tk_.Consume("{");
+    while (!tk_.QueryConsume("}")) {
+      string field(tk_.ConsumeToken());
 
-        tk_.Consume(":");
-        struct_types[name][field] = ReadType(tk_);
+      if (struct_types.count(name) && struct_types.at(name).count(field)) {
+        tk_.Error("Two fields of same struct with same name: " + field);
       }
+
+      tk_.Consume(":");
+      struct_types[name][field] = ReadType(tk_);
     }
+  }
 
-    // Program functions.
-    vector<Function> functions;
+ private:
+  static void ThrowParseError(const string& message) {
+    throw ParseError{message};
+  }
 
-    // Parse function definitions.
-    while (!tk_.EndOfInput()) {
-      Function fun = ReadFunction();
-      functions.emplace_back(fun);
-    }
+  // Returns a new variable. If there is an arena then the variable is
+  // allocated in it, and the result doesn't own it.
+  VarPtr_t NewVariable(const string& name, const Type& type) {
+    if (arena_ == nullptr) return make_shared<const Variable>(name, type);
+    return VarPtr_t(VarPtr_t(), arena_->New<const Variable>(name, type));
+  }
+
+  // Freeing an arena of variables shouldn't have to visit them.
+  static_assert(std::is_trivially_destructible_v<Variable>);
 
-    return Program(struct_types, functions);
+  VarPtr_t NewLocal(const string& name, const Type& type) {
+    return NewVariable(name, type);
   }
 
- private:
-  inline static set<char> whitespace_{' ', '\n'};
-  inline static set<string> delimiters_{":", ",", "=", "->", "*", "[",
-                                        "]", "{", "}", "(",  ")"};
-  inline static set<string> reserved_{
-      "$arith", "$cmp",    "$phi",  "$alloc", "$addrof", "$load", "$store",
-      "$gep",   "$select", "$call", "$icall", "$ret",    "$jump", "$branch"};
+  // Returns a variable for a global we haven't seen before (although helpers
+  // sharing our globals may have).
+  VarPtr_t NewGlobal(const string& name, const Type& type) {
+    auto var = NewVariable(name, type);
+    return shared_globals_ ? shared_globals_->Intern(var) : var;
+  }
 
-  util::Tokenizer tk_;
+  util::Lexer tk_;
+  SharedGlobals* shared_globals_;
+  bool throw_errors_ = false;
+
+  // Where to allocate variables, if anywhere.
+  util::Arena* arena_ = nullptr;
 
   // Variables that are local to a function, indexed by name.
   unordered_map<string, VarPtr_t> vars_;
 
-  // Variables that refer to global function pointers, indexed by name.
+  // Variables that refer to global function pointers, indexed by name (a cache
+  // of 'shared_globals_', if there are any).
   unordered_map<string, VarPtr_t> func_vars_;
 
-  // Variables that refer to global null pointers, indexed by type.
+  // Variables that refer to global null pointers, indexed by type (a cache of
+  // 'shared_globals_', if there are any).
   unordered_map<Type, VarPtr_t> null_vars_;
 };
 
+// Finds where the top-level items of a program (struct type and function
+// definitions) end by matching braces, without otherwise parsing the text.
+// The text can be given incrementally, e.g., as it is read from a stream.
+class ItemSplitter {
+ public:
+  // Returns the offset just past the end of the next complete item in 'text',
+  // or string::npos if 'text' doesn't contain a complete item yet. Scanning
+  // resumes where the last call stopped, so 'text' should only have been
+  // appended to since then (see also Rebase()).
+  size_t NextItemEnd(std::string_view text) {
+    while ((pos_ = text.find_first_of("{}", pos_)) != string::npos) {
+      if (text[pos_++] == '{') {
+        depth_++;
+      } else if (depth_ > 0 && --depth_ == 0) {
+        return pos_;
+      }
+    }
+    pos_ = text.size();
+    return string::npos;
+  }
+
+  // Must be called when the first 'count' characters of the text have been
+  // removed.
+  void Rebase(size_t count) { pos_ -= count; }
+
+ private:
+  // The position at which to resume scanning, and the current brace depth.
+  size_t pos_ = 0;
+  int depth_ = 0;
+};
+
+// A top-level item's text and the line on which it starts.
+struct Item {
+  std::string_view text;
+  int first_line;
+};
+
+// Splits a program into its top-level items.
+vector<Item> SplitItems(std::string_view program) {
+  vector<Item> items;
+  ItemSplitter splitter;
+  size_t start = 0;
+  int line = 1;
+  for (size_t end; (end = splitter.NextItemEnd(program)) != string::npos;
+       start = end) {
+    items.push_back({program.substr(start, end - start), line});
+    line += std::count(program.begin() + start, program.begin() + end, '\n');
+  }
+
+  // Anything left over must be an incomplete item (which will fail to parse)
+  // or whitespace.
+  if (program.find_first_not_of(" \n", start) != string::npos) {
+    items.push_back({program.substr(start), line});
+  }
+
+  return items;
+}
+
+// The parts of a program, as read from text.
+struct ProgramParts {
+  map<string, map<string, Type>> struct_types;
+  vector<Function> functions;
+
+  // The arena that owns the functions' variables, if the options said to use
+  // one.
+  shared_ptr<util::Arena> arena;
+};
+
+// Returns the number of threads to parse with.
+int NumThreads(const ParseOptions& options) {
+  CHECK_GE(options.num_threads, 0) << "number of threads must be non-negative";
+  if (options.num_threads > 0) return options.num_threads;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Reads the struct types and functions of a program as specified by 'options',
+// parsing its functions on NumThreads(options) threads. Functions are
+// independent apart from the struct types (which come first, so are read up
+// front) and the global variables (which the threads share). If 'errors' is
+// non-null then each malformed struct type or function is skipped and its
+// error appended to 'errors' instead of FATALing.
+ProgramParts ReadProgramParts(std::string_view program,
+                              const ParseOptions& options,
+                              vector<string>* errors) {
+  vector<Item> items = SplitItems(program);
+
+  // Reads all of 'item' using 'read'; returns the error if the item is
+  // malformed (and errors are being collected).
+  const auto read_item = [](FromStringHelper& helper, const Item& item,
+                            const std::function<void()>& read) {
+    optional<string> error;
+    helper.SetInput(item.text, item.first_line);
+    try {
+      read();
+      helper.CheckEndOfInput();
+    } catch (const ParseError& err) {
+      error = err.message;
+    }
+    return error;
+  };
+
+  ProgramParts parts;
+  size_t first_function = 0;
+  FromStringHelper struct_helper("");
+  if (errors != nullptr) struct_helper.ThrowErrors();
+  for (; first_function < items.size(); first_function++) {
+    const Item& item = items[first_function];
+    struct_helper.SetInput(item.text, item.first_line);
+    if (!struct_helper.AtStructType()) break;
+
+    auto error = read_item(struct_helper, item, [&]() {
+      struct_helper.ReadStructType(parts.struct_types);
+    });
+    if (error) errors->push_back(*error);
+  }
+
+  // Each thread repeatedly takes the next function that hasn't been parsed.
+  // Arenas aren't thread-safe, so each thread allocates in an arena of its own
+  // and the arenas are merged afterwards.
+  SharedGlobals globals;
+  vector<optional<Function>> functions(items.size() - first_function);
+  vector<optional<string>> function_errors(functions.size());
+  int num_threads =
+      std::clamp<size_t>(functions.size(), 1, NumThreads(options));
+  vector<shared_ptr<util::Arena>> arenas;
+  if (options.use_arena) {
+    for (int i = 0; i < num_threads; i++) {
+      arenas.push_back(make_shared<util::Arena>());
+    }
+  }
+  std::atomic<size_t> next(0);
+  const auto worker = [&](int thread) {
+    FromStringHelper helper("", 1, &globals);
+    if (errors != nullptr) helper.ThrowErrors();
+    if (options.use_arena) helper.UseArena(arenas[thread].get());
+    for (size_t i; (i = next++) < functions.size();) {
+      function_errors[i] =
+          read_item(helper, items[first_function + i],
+                    [&]() { functions[i].emplace(helper.ReadFunction()); });
+    }
+  };
+
+  vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++) threads.emplace_back(worker, i);
+  worker(0);
+  for (auto& thread : threads) thread.join();
+
+  if (options.use_arena) {
+    parts.arena = arenas[0];
+    for (int i = 1; i < num_threads; i++) {
+      parts.arena->Adopt(std::move(*arenas[i]));
+    }
+  }
+
+  parts.functions.reserve(functions.size());
+  for (size_t i = 0; i < functions.size(); i++) {
+    if (function_errors[i]) {
+      errors->push_back(*function_errors[i]);
+    } else {
+      parts.functions.push_back(std::move(*functions[i]));
+    }
+  }
+
+  return parts;
+}
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// The interned struct and function types and pointers to them. Lookups take a
+// shared lock, so that threads parsing in parallel only contend when they see
+// a type for the first time.
+class Type::Table {
+ public:
+  // The table is never destroyed, so that types stay valid while other static
+  // objects are being destroyed.
+  static Table& Get() {
+    static Table* table = new Table;
+    return *table;
+  }
+
+  const Node* Struct(const string& name) {
+    return Intern(structs_, name, [&] {
+      size_t hash = kStruct;
+      hash_combine(hash, name);
+      return NewNode(0, name, hash, nullptr);
+    });
+  }
+
+  const Node* Function(const vector<Type>& types) {
+    return Intern(functions_, types, [&] {
+      size_t hash = kFunc;
+      hash_combine(hash, types);
+      return NewNode(0, types, hash, nullptr);
+    });
+  }
+
+  const Node* PtrTo(const Node* node) {
+    std::unique_lock lock(mutex_);
+    const Node* ptr_to = node->ptr_to.load(std::memory_order_relaxed);
+    if (ptr_to == nullptr) {
+      size_t hash = node->hash;
+      hash_combine(hash, node->indirection + 1);
+      ptr_to = NewNode(node->indirection + 1, node->base_type, hash, node);
+      node->ptr_to.store(ptr_to, std::memory_order_release);
+    }
+    return ptr_to;
+  }
+
+ private:
+  struct TypesHash {
+    size_t operator()(const vector<Type>& types) const {
+      size_t hash = 0;
+      hash_combine(hash, types);
+      return hash;
+    }
+  };
+
+  // Returns the node for 'key' in 'nodes', first adding the result of
+  // 'make_node' if there isn't one.
+  template <typename Map, typename Key, typename MakeNode>
+  const Node* Intern(Map& nodes, const Key& key, MakeNode make_node) {
+    {
+      std::shared_lock lock(mutex_);
+      auto it = nodes.find(key);
+      if (it != nodes.end()) return it->second;
+    }
+    std::unique_lock lock(mutex_);
+    auto [it, inserted] = nodes.emplace(key, nullptr);
+    if (inserted) it->second = make_node();
+    return it->second;
+  }
+
+  const Node* NewNode(int indirection, const TypeVariant& base_type,
+                      size_t hash, const Node* deref) {
+    return owned_nodes_
+        .emplace_back(new Node{indirection, base_type, hash, deref, {nullptr}})
+        .get();
+  }
+
+  std::shared_mutex mutex_;
+  unordered_map<string, const Node*> structs_;
+  unordered_map<vector<Type>, const Node*, TypesHash> functions_;
+  vector<unique_ptr<const Node>> owned_nodes_;
+};
+
+const Type::Node Type::int_node_{0, std::monostate(), kInt, nullptr, {nullptr}};
+
+const Type::Node* Type::InternStruct(const string& name) {
+  return Table::Get().Struct(name);
+}
+
+const Type::Node* Type::InternFunction(const vector<Type>& types) {
+  return Table::Get().Function(types);
+}
+
+const Type::Node* Type::InternPtrTo(const Node* node) {
+  return Table::Get().PtrTo(node);
+}
+
 string Type::ToString() const {
   switch (BaseKind()) {
     case kInt:
-      return "int"s + string(indirection_, '*');
+      return "int"s + string(indirection(), '*');
 
     case kStruct:
-      return GetStructName() + string(indirection_, '*');
+      return GetStructName() + string(indirection(), '*');
 
     case kFunc: {
       auto& types = GetFuncTypes();
@@ -296,13 +709,13 @@ string Type::ToString() const {
         out << *type_strs.rbegin();
       }
       out << "]";
-      return out.str() + string(indirection_, '*');
+      return out.str() + string(indirection(), '*');
     }
   }
 }
 
 Type Type::FromString(const string& type) {
-  util::Tokenizer tk(type, {}, {"[", "]", ",", "*"}, {});
+  util::Lexer tk(type, TypeLexerSpec());
   return ReadType(tk);
 }
 
@@ -396,25 +809,64 @@ Instruction Instruction::FromString(const string& instruction) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-BasicBlock::BasicBlock(const string& label, const vector<Instruction>& body,
+BasicBlock::BasicBlock(util::Symbol label, const vector<Instruction>& body,
                        const Function* parent)
     : label_(label), parent_(parent) {
-  CHECK_NE(label_, "") << "label must be non-empty";
+  CHECK(!label.empty()) << "label must be non-empty";
   CHECK(!body.empty()) << "body must be non-empty";
 
+  body_.reserve(body.size());
   for (const auto& inst : body) {
     body_.emplace_back(inst, this);
   }
 }
 
+BasicBlock::BasicBlock(util::Symbol label, vector<Instruction>&& body,
+                       const Function* parent)
+    : label_(label), body_(std::move(body)), parent_(parent) {
+  CHECK(!label.empty()) << "label must be non-empty";
+  CHECK(!body_.empty()) << "body must be non-empty";
+
+  for (auto& inst : body_) inst.parent_ = this;
+}
+
 // The copy constructor needs to update the parent pointers of the instructions.
 BasicBlock::BasicBlock(const BasicBlock& bb)
-    : label_(bb.label_), parent_(bb.parent_) {
+    : label_(bb.label_),
+      parent_(bb.parent_),
+      id_(bb.id_),
+      first_inst_id_(bb.first_inst_id_) {
+  body_.reserve(bb.body_.size());
   for (const auto& inst : bb.body_) {
     body_.emplace_back(inst, this);
   }
 }
 
+// So does the move constructor, although the instructions themselves stay put.
+BasicBlock::BasicBlock(BasicBlock&& bb) noexcept
+    : label_(bb.label_),
+      body_(std::move(bb.body_)),
+      parent_(bb.parent_),
+      id_(bb.id_),
+      first_inst_id_(bb.first_inst_id_) {
+  for (auto& inst : body_) inst.parent_ = this;
+}
+
+BasicBlock& BasicBlock::operator=(const BasicBlock& bb) {
+  return *this = BasicBlock(bb);
+}
+
+BasicBlock& BasicBlock::operator=(BasicBlock&& bb) noexcept {
+  if (this == &bb) return *this;
+  label_ = bb.label_;
+  body_ = std::move(bb.body_);
+  parent_ = bb.parent_;
+  id_ = bb.id_;
+  first_inst_id_ = bb.first_inst_id_;
+  for (auto& inst : body_) inst.parent_ = this;
+  return *this;
+}
+
 const Instruction& BasicBlock::operator[](int index) const {
   CHECK(index >= 0 && index < body_.size()) << "index out of bounds";
   return body_[index];
@@ -442,41 +894,334 @@ BasicBlock BasicBlock::FromString(const string& basic_block) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-Function::Function(const string& name, const Type& return_type,
+Function::Function(util::Symbol name, const Type& return_type,
                    const vector<VarPtr_t>& parameters,
                    const vector<BasicBlock>& body)
+    : Function(name, return_type, parameters, vector<BasicBlock>(body)) {}
+
+Function::Function(util::Symbol name, const Type& return_type,
+                   const vector<VarPtr_t>& parameters,
+                   vector<BasicBlock>&& body)
     : name_(name), return_type_(return_type), parameters_(parameters) {
-  CHECK_NE(name_, "") << "name must be non-empty";
+  CHECK(!name.empty()) << "name must be non-empty";
   CHECK(!body.empty()) << "body must be non-empty";
 
-  for (const auto& block : body) {
-    CHECK(!body_.count(block.label()))
-        << "cannot have duplicate basic block labels";
-    body_[block.label()] =
-        make_shared<BasicBlock>(block.label(), block.body(), this);
+  size_t num_insts = 0;
+  for (const auto& block : body) num_insts += block.body().size();
+  layout_->reserve(body.size());
+  blocks_.reserve(body.size());
+  insts_.reserve(num_insts);
+
+  // Lay out the entry block first, and then the rest in the order given.
+  static const util::Symbol entry("entry");
+  auto is_entry = [&](const BasicBlock& bb) {
+    return bb.label_symbol() == entry;
+  };
+  auto entry_bb = std::find_if(body.begin(), body.end(), is_entry);
+  if (entry_bb != body.end()) AddBlock(std::move(*entry_bb));
+  for (auto it = body.begin(); it != body.end(); ++it) {
+    if (it != entry_bb) AddBlock(std::move(*it));
   }
+  NumberLocals();
+  IndexBlocks();
 }
 
 // The copy constructor needs to update the parent pointers of the basic blocks.
 Function::Function(const Function& func)
     : name_(func.name_),
       return_type_(func.return_type_),
-      parameters_(func.parameters_) {
-  for (const auto& [label, bb] : func.body()) {
-    body_[label] = make_shared<BasicBlock>(label, bb->body(), this);
+      parameters_(func.parameters_),
+      locals_(func.locals_),
+      arena_(func.arena_) {
+  blocks_.reserve(func.blocks_.size());
+  insts_.reserve(func.insts_.size());
+  layout_->reserve(func.layout_->size());
+  for (const auto& bb : *func.layout_) AddBlock(BasicBlock(bb));
+  IndexBlocks();
+}
+
+// So does the move constructor, although the basic blocks themselves (and so
+// their numbering) stay put.
+Function::Function(Function&& func) noexcept
+    : name_(func.name_),
+      return_type_(func.return_type_),
+      parameters_(std::move(func.parameters_)),
+      layout_(std::move(func.layout_)),
+      block_ids_(std::move(func.block_ids_)),
+      label_order_(std::move(func.label_order_)),
+      blocks_(std::move(func.blocks_)),
+      insts_(std::move(func.insts_)),
+      locals_(std::move(func.locals_)),
+      arena_(std::move(func.arena_)),
+      call_sites_(std::move(func.call_sites_)),
+      callers_(std::move(func.callers_)),
+      cfg_(std::move(func.cfg_)),
+      dominators_(std::move(func.dominators_)),
+      reverse_cfg_(std::move(func.reverse_cfg_)),
+      post_dominators_(std::move(func.post_dominators_)),
+      control_dependence_(std::move(func.control_dependence_)),
+      compact_code_(std::move(func.compact_code_)),
+      blocks_by_label_(std::move(func.blocks_by_label_)) {
+  // The blocks were created non-const by AddBlock().
+  for (const BasicBlock* bb : blocks_) {
+    const_cast<BasicBlock*>(bb)->parent_ = this;
+  }
+}
+
+Function& Function::operator=(const Function& func) {
+  return *this = Function(func);
+}
+
+Function& Function::operator=(Function&& func) noexcept {
+  if (this == &func) return *this;
+  name_ = func.name_;
+  return_type_ = func.return_type_;
+  parameters_ = std::move(func.parameters_);
+  layout_ = std::move(func.layout_);
+  block_ids_ = std::move(func.block_ids_);
+  label_order_ = std::move(func.label_order_);
+  blocks_ = std::move(func.blocks_);
+  insts_ = std::move(func.insts_);
+  locals_ = std::move(func.locals_);
+  arena_ = std::move(func.arena_);
+  call_sites_ = std::move(func.call_sites_);
+  callers_ = std::move(func.callers_);
+
+  cfg_ = std::move(func.cfg_);
+  dominators_ = std::move(func.dominators_);
+  reverse_cfg_ = std::move(func.reverse_cfg_);
+  post_dominators_ = std::move(func.post_dominators_);
+  control_dependence_ = std::move(func.control_dependence_);
+  compact_code_ = std::move(func.compact_code_);
+  blocks_by_label_ = std::move(func.blocks_by_label_);
+
+  for (const BasicBlock* bb : blocks_) {
+    const_cast<BasicBlock*>(bb)->parent_ = this;
+  }
+  return *this;
+}
+
+// Defined here, where the cached analyses' types are complete.
+Function::~Function() = default;
+
+void Function::AddBlock(BasicBlock&& block) {
+  CHECK_LT(layout_->size(), layout_->capacity());
+  BasicBlock& bb = layout_->emplace_back(std::move(block));
+  bb.parent_ = this;
+  bb.id_ = blocks_.size();
+  bb.first_inst_id_ = insts_.size();
+
+  blocks_.push_back(&bb);
+  for (const auto& inst : bb.body()) {
+    insts_.push_back(&inst);
+    if (inst.GetOpcode() == Instruction::kCall ||
+        inst.GetOpcode() == Instruction::kICall) {
+      call_sites_.push_back(&inst);
+    }
+  }
+}
+
+namespace {  // Helpers for Function::NumberLocals().
+
+// Calls 'func' on each variable that 'inst' assigns or uses, in the order of
+// the instruction's constructor parameters.
+template <typename Func>
+void ForEachVar(const Instruction& inst, Func&& func) {
+  const auto op = [&](const Operand& op) {
+    if (op.IsVariable()) func(op.GetVar());
+  };
+  const auto ops = [&](const vector<Operand>& ops) {
+    for (const auto& o : ops) op(o);
+  };
+
+  switch (inst.GetOpcode()) {
+    case Instruction::kArith:
+      func(inst.AsArith().lhs());
+      op(inst.AsArith().op1());
+      op(inst.AsArith().op2());
+      break;
+
+    case Instruction::kCmp:
+      func(inst.AsCmp().lhs());
+      op(inst.AsCmp().op1());
+      op(inst.AsCmp().op2());
+      break;
+
+    case Instruction::kPhi:
+      func(inst.AsPhi().lhs());
+      ops(inst.AsPhi().ops());
+      break;
+
+    case Instruction::kCopy:
+      func(inst.AsCopy().lhs());
+      op(inst.AsCopy().rhs());
+      break;
+
+    case Instruction::kAlloc:
+      func(inst.AsAlloc().lhs());
+      break;
+
+    case Instruction::kAddrof:
+      func(inst.AsAddrOf().lhs());
+      func(inst.AsAddrOf().rhs());
+      break;
+
+    case Instruction::kLoad:
+      func(inst.AsLoad().lhs());
+      func(inst.AsLoad().src());
+      break;
+
+    case Instruction::kStore:
+      func(inst.AsStore().dst());
+      op(inst.AsStore().value());
+      break;
+
+    case Instruction::kGep:
+      func(inst.AsGep().lhs());
+      func(inst.AsGep().src_ptr());
+      op(inst.AsGep().index());
+      break;
+
+    case Instruction::kSelect:
+      func(inst.AsSelect().lhs());
+      op(inst.AsSelect().condition());
+      op(inst.AsSelect().true_op());
+      op(inst.AsSelect().false_op());
+      break;
+
+    case Instruction::kCall:
+      func(inst.AsCall().lhs());
+      ops(inst.AsCall().args());
+      break;
+
+    case Instruction::kICall:
+      func(inst.AsICall().lhs());
+      func(inst.AsICall().func_ptr());
+      ops(inst.AsICall().args());
+      break;
+
+    case Instruction::kRet:
+      op(inst.AsRet().retval());
+      break;
+
+    case Instruction::kJump:
+      break;
+
+    case Instruction::kBranch:
+      op(inst.AsBranch().condition());
+      break;
+  }
+}
+
+}  // namespace
+
+void Function::NumberLocals() {
+  auto locals = make_shared<LocalTable>();
+
+  // Start with room for about one variable per parameter and instruction.
+  size_t num_slots = 16;
+  while (num_slots < 2 * (parameters_.size() + insts_.size())) num_slots *= 2;
+  locals->slots.assign(num_slots, -1);
+
+  const auto add_local = [&](const VarPtr_t& var) {
+    if (var->name()[0] == '@') return;
+    size_t slot = locals->Slot(var.get());
+    if (locals->slots[slot] >= 0) return;
+
+    locals->slots[slot] = locals->vars.size();
+    locals->vars.push_back(var.get());
+    if (2 * locals->vars.size() > locals->slots.size()) {
+      locals->slots.assign(2 * locals->slots.size(), -1);
+      for (size_t id = 0; id < locals->vars.size(); ++id) {
+        locals->slots[locals->Slot(locals->vars[id])] = id;
+      }
+    }
+  };
+  for (const auto& param : parameters_) add_local(param);
+  for (const Instruction* inst : insts_) ForEachVar(*inst, add_local);
+
+  locals_ = std::move(locals);
+}
+
+void Function::IndexBlocks() {
+  vector<pair<util::Symbol, int>> ids;
+  ids.reserve(layout_->size());
+  for (const BasicBlock& bb : *layout_) {
+    ids.emplace_back(bb.label_symbol(), bb.id_);
+  }
+  block_ids_ = util::SymbolMap<int>(std::move(ids));
+
+  label_order_.resize(layout_->size());
+  std::iota(label_order_.begin(), label_order_.end(), 0);
+  std::sort(label_order_.begin(), label_order_.end(), [&](int id1, int id2) {
+    return (*layout_)[id1].label() < (*layout_)[id2].label();
+  });
+
+  for (BasicBlock& bb : *layout_) {
+    for (Instruction& inst : bb.body_) {
+      if (auto* jump = std::get_if<JumpInst>(&inst.inst_)) {
+        jump->target_ = FindBlock(jump->label_);
+      } else if (auto* branch = std::get_if<BranchInst>(&inst.inst_)) {
+        branch->target_true_ = FindBlock(branch->label_true_);
+        branch->target_false_ = FindBlock(branch->label_false_);
+      }
+    }
   }
 }
 
 const BasicBlock& Function::operator[](const string& label) const {
-  CHECK(body_.count(label)) << "unknown basic block label";
-  return *body_.at(label);
+  const BasicBlock* bb = FindBlock(util::Symbol(label));
+  CHECK(bb != nullptr) << "unknown basic block label";
+  return *bb;
+}
+
+const Cfg& Function::cfg() const {
+  return cfg_.Get([&] { return make_unique<const Cfg>(*this); });
+}
+
+const DominatorTree& Function::dominators() const {
+  return dominators_.Get(
+      [&] { return make_unique<const DominatorTree>(cfg()); });
+}
+
+const Cfg& Function::reverse_cfg() const {
+  return reverse_cfg_.Get(
+      [&] { return make_unique<const Cfg>(cfg().Reverse()); });
+}
+
+const DominatorTree& Function::post_dominators() const {
+  return post_dominators_.Get([&] {
+    return make_unique<const DominatorTree>(reverse_cfg());
+  });
+}
+
+const ControlDependence& Function::control_dependence() const {
+  return control_dependence_.Get([&] {
+    return make_unique<const ControlDependence>(cfg(), post_dominators());
+  });
+}
+
+const CompactCode& Function::compact_code() const {
+  return compact_code_.Get(
+      [&] { return make_unique<const CompactCode>(*this); });
+}
+
+const map<string, BbPtr_t>& Function::body() const {
+  return blocks_by_label_.Get([&] {
+    auto body = make_unique<map<string, BbPtr_t>>();
+    for (int id : label_order_) {
+      body->emplace_hint(body->end(), (*layout_)[id].label(),
+                         BbPtr_t(layout_, &(*layout_)[id]));
+    }
+    return unique_ptr<const map<string, BbPtr_t>>(std::move(body));
+  });
 }
 
 void Function::Visit(IrVisitor* visitor) const {
   visitor->VisitFunction(*this);
 
-  for (const auto& [label, bb] : body_) {
-    bb->Visit(visitor);
+  for (int id : label_order_) {
+    (*layout_)[id].Visit(visitor);
   }
 
   visitor->VisitFunctionPost(*this);
@@ -496,15 +1241,137 @@ Function Function::FromString(const string& function) {
 
 Program::Program(const map<string, map<string, Type>>& struct_types,
                  const vector<Function>& functions)
-    : struct_types_(struct_types) {
-  for (const auto& func : functions) {
-    CHECK(!functions_.count(func.name()))
-        << "cannot have duplicate function names";
-    functions_[func.name()] = make_shared<Function>(func);
+    : Program(struct_types, vector<Function>(functions), nullptr) {}
+
+Program::Program(const map<string, map<string, Type>>& struct_types,
+                 vector<Function>&& functions)
+    : Program(struct_types, std::move(functions), nullptr) {}
+
+Program::Program(const map<string, map<string, Type>>& struct_types,
+                 vector<Function>&& functions, string* errors,
+                 shared_ptr<const util::Arena> arena)
+    : struct_types_(struct_types), arena_(std::move(arena)) {
+  string errs;
+  for (auto& func : functions) {
+    if (functions_.count(func.name())) {
+      CHECK(errors != nullptr) << "cannot have duplicate function names";
+      errs += "Duplicate function name: " + func.name() + "\n";
+      continue;
+    }
+    if (arena_ != nullptr) func.arena_ = arena_;
+    functions_[func.name()] = make_shared<Function>(std::move(func));
+  }
+
+  vector<pair<util::Symbol, const Function*>> functions_by_name;
+  functions_by_name.reserve(functions_.size());
+  for (const auto& [name, func] : functions_) {
+    functions_by_name.emplace_back(func->name_symbol(), func.get());
+  }
+  functions_by_name_ =
+      util::SymbolMap<const Function*>(std::move(functions_by_name));
+
+  IndexStructs();
+  ResolveFunctions();
+
+  errs += VerifyIr();
+  if (errors != nullptr) {
+    *errors = errs;
+  } else {
+    CHECK_EQ(errs, "") << "Malformed program: " << std::endl << errs;
+  }
+}
+
+void Program::IndexStructs() {
+  vector<pair<util::Symbol, int>> structs_by_name;
+  structs_.reserve(struct_types_.size());
+  structs_by_name.reserve(struct_types_.size());
+  for (const auto& [name, fields] : struct_types_) {
+    StructLayout& layout = structs_.emplace_back();
+    layout.name_ = util::Symbol(name);
+
+    vector<pair<util::Symbol, int>> field_indices;
+    for (const auto& [field_name, type] : fields) {
+      util::Symbol field(field_name);
+      field_indices.emplace_back(field, layout.fields_.size());
+      layout.fields_.push_back({field, type, -1});
+    }
+    layout.field_indices_ = util::SymbolMap<int>(std::move(field_indices));
+    structs_by_name.emplace_back(layout.name_, structs_by_name.size());
+  }
+  structs_by_name_ = util::SymbolMap<int>(std::move(structs_by_name));
+
+  // 0 for a struct type not yet laid out, 1 for one being laid out, and 2 for
+  // one laid out.
+  vector<char> state(structs_.size(), 0);
+  for (size_t id = 0; id < structs_.size(); ++id) {
+    if (state[id] == 0) LayOutStruct(id, state);
+  }
+}
+
+void Program::LayOutStruct(int id, vector<char>& state) {
+  StructLayout& layout = structs_[id];
+  state[id] = 1;
+  for (auto& field : layout.fields_) {
+    field.offset = layout.units_.size();
+
+    // A struct type that contains itself is malformed (see VerifyIr()); the
+    // inner occurrence is laid out as a single unit, as is a nonexistent
+    // struct type.
+    const int* nested = nullptr;
+    if (field.type.IsStruct()) {
+      nested = structs_by_name_.Find(util::Symbol(field.type.GetStructName()));
+    }
+    if (nested == nullptr || state[*nested] == 1) {
+      layout.units_.push_back(field.type);
+      continue;
+    }
+
+    if (state[*nested] == 0) LayOutStruct(*nested, state);
+    const vector<Type>& units = structs_[*nested].units_;
+    layout.units_.insert(layout.units_.end(), units.begin(), units.end());
   }
+  state[id] = 2;
+}
+
+void Program::ResolveFunctions() {
+  // Struct pointer type ==> struct id, for the types seen so far.
+  unordered_map<Type, int> struct_ids;
+
+  // The functions were created non-const by the constructor.
+  for (const auto& [name, func] : functions_) {
+    for (const Instruction* inst : func->call_sites()) {
+      auto& inst_variant = const_cast<Instruction*>(inst)->inst_;
+      auto* call = std::get_if<CallInst>(&inst_variant);
+      if (call == nullptr) continue;
+      call->target_ = FindFunction(call->callee_);
+      if (call->target_ != nullptr) {
+        const_cast<Function*>(call->target_)->callers_.push_back(inst);
+      }
+    }
+
+    for (const Instruction* inst : func->instructions()) {
+      if (inst->GetOpcode() != Instruction::kGep) continue;
+      auto& gep = std::get<GepInst>(const_cast<Instruction*>(inst)->inst_);
+      // A function copied from another program has that program's ids.
+      gep.struct_id_ = -1;
+      gep.field_index_ = -1;
+      const Type& type = gep.src_ptr_->type();
+      if (gep.field_name_.empty() || !type.IsStructPtr()) continue;
+
+      auto [it, inserted] = struct_ids.try_emplace(type, -1);
+      if (inserted) {
+        const int* id =
+            structs_by_name_.Find(util::Symbol(type.GetStructName()));
+        if (id != nullptr) it->second = *id;
+      }
+      if (it->second < 0) continue;
 
-  string errs = VerifyIr();
-  CHECK_EQ(errs, "") << "Malformed program: " << std::endl << errs;
+      int field_index = structs_[it->second].FieldIndex(gep.field_name_);
+      if (field_index < 0) continue;
+      gep.struct_id_ = it->second;
+      gep.field_index_ = field_index;
+    }
+  }
 }
 
 const Function& Program::operator[](const string& name) const {
@@ -532,17 +1399,159 @@ string Program::ToString() const {
   return visitor.GetString();
 }
 
-Program Program::FromString(const string& program) {
-  return FromStringHelper(program).ReadProgram();
+void Program::WriteTo(std::ostream& out) const {
+  util::BufferedWriter writer(&out);
+  ToStringVisitor visitor(&writer);
+  this->Visit(&visitor);
+}
+
+void Program::WriteToFile(const string& path) const {
+  util::BufferedWriter writer(path);
+  ToStringVisitor visitor(&writer);
+  this->Visit(&visitor);
+}
+
+Program Program::Read(std::string_view program,
+                      const ParseOptions& options) {
+  ProgramParts parts = ReadProgramParts(program, options, /*errors=*/nullptr);
+  return Program(parts.struct_types, std::move(parts.functions),
+                 /*errors=*/nullptr, std::move(parts.arena));
+}
+
+Program Program::FromString(const string& program,
+                            const ParseOptions& options) {
+  return Read(program, options);
+}
+
+optional<Program> Program::Parse(const string& program,
+                                 vector<string>* errors,
+                                 const ParseOptions& options) {
+  CHECK(errors != nullptr) << "errors must be non-null";
+  errors->clear();
+
+  ProgramParts parts = ReadProgramParts(program, options, errors);
+  if (!errors->empty()) return nullopt;
+
+  string verify_errors;
+  Program result(parts.struct_types, std::move(parts.functions),
+                 &verify_errors, std::move(parts.arena));
+  if (verify_errors.empty()) return result;
+
+  // The verifier ends some errors with a blank line.
+  std::istringstream lines(verify_errors);
+  for (string err; std::getline(lines, err);) {
+    if (!err.empty()) errors->push_back(err);
+  }
+  return nullopt;
+}
+
+Program Program::FromFile(const string& path, const ParseOptions& options) {
+  util::MappedFile file(path);
+  return Read(file.contents(), options);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TextImage::TextImage(std::string_view text)
+    : globals_(make_unique<SharedGlobals>()) {
+  FromStringHelper helper("");
+  for (const Item& item : SplitItems(text)) {
+    helper.SetInput(item.text, item.first_line);
+    if (function_text_.empty() && helper.AtStructType()) {
+      // As in FromString(), struct types must precede functions.
+      helper.ReadStructType(struct_types_);
+      helper.CheckEndOfInput();
+    } else {
+      // The rest of the function is read by ReadFunction().
+      auto [name, type] = helper.ReadFunctionHeader();
+      function_names_.push_back(name);
+      function_types_.push_back(type);
+      function_text_.emplace_back(item.text, item.first_line);
+    }
+  }
+}
+
+TextImage::~TextImage() = default;
+
+Function TextImage::ReadFunction(int index) const {
+  CHECK(index >= 0 && static_cast<size_t>(index) < function_text_.size())
+      << "function index out of bounds";
+  const auto& [text, first_line] = function_text_[index];
+  FromStringHelper helper(text, first_line, globals_.get());
+  Function function = helper.ReadFunction();
+  helper.CheckEndOfInput();
+  return function;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Program Program::FromStream(std::istream& in, size_t chunk_size) {
+  CHECK_GT(chunk_size, 0) << "chunk size must be positive";
+
+  FromStringHelper helper("");
+  map<string, map<string, Type>> struct_types;
+  vector<Function> functions;
+
+  // Parses one top-level item; 'line' is the line on which it starts.
+  int line = 1;
+  const auto read_item = [&](std::string_view item) {
+    helper.SetInput(item, line);
+    // As in FromString(), struct types must precede functions.
+    if (functions.empty() && helper.AtStructType()) {
+      helper.ReadStructType(struct_types);
+    } else {
+      functions.push_back(helper.ReadFunction());
+    }
+    helper.CheckEndOfInput();
+    line += std::count(item.begin(), item.end(), '\n');
+  };
+
+  // The unparsed input read so far is buffer[start...]; each item is parsed
+  // (and its text discarded) as soon as it has been completely read.
+  string buffer;
+  size_t start = 0;
+  ItemSplitter splitter;
+  vector<char> chunk(chunk_size);
+
+  while (in) {
+    in.read(chunk.data(), chunk.size());
+    buffer.erase(0, start);
+    splitter.Rebase(start);
+    start = 0;
+    buffer.append(chunk.data(), in.gcount());
+
+    for (size_t end; (end = splitter.NextItemEnd(buffer)) != string::npos;
+         start = end) {
+      read_item(std::string_view(buffer).substr(start, end - start));
+    }
+  }
+
+  // Anything left over must be an incomplete item (which will fail to parse)
+  // or whitespace.
+  std::string_view rest = std::string_view(buffer).substr(start);
+  if (rest.find_first_not_of(" \n") != string::npos) read_item(rest);
+
+  return Program(struct_types, std::move(functions));
 }
 
 namespace {  // Helper visitor class for Program::Verify.
 
 class VerifyVisitor : public IrVisitor {
  public:
+  // Verifies functions (rather than a whole program) as if they were part of a
+  // program with the given struct types and functions (function name ==>
+  // function type).
+  void SetContext(const map<string, map<string, Type>>& struct_types,
+                  const map<string, Type>& function_types) {
+    struct_types_ = &struct_types;
+    function_types_ = &function_types;
+  }
+
   // Resets the visitor to its initial state.
   void Reset() {
     err_.clear();
+    struct_types_ = nullptr;
+    function_types_ = nullptr;
     program_ = nullptr;
     curr_function_ = nullptr;
     bb_id_ = "";
@@ -558,6 +1567,11 @@ class VerifyVisitor : public IrVisitor {
   map<string, VarPtr_t> GetGlobalFuncPtrs() { return func_ptrs_; }
 
   void VisitProgram(const Program& program) override {
+    program_function_types_.clear();
+    for (const auto& [name, fun] : program.functions()) {
+      program_function_types_[name] = FunctionType(*fun);
+    }
+    SetContext(program.struct_types(), program_function_types_);
     program_ = &program;
 
     if (program.functions().count("main") == 0) {
@@ -591,23 +1605,36 @@ class VerifyVisitor : public IrVisitor {
       }
       ReportIfNonexistentStruct(type);
     }
+
+    set<string> visited;
+    if (ContainsStruct(name, name, visited)) {
+      err_ << "Struct type can't contain itself (other than through a "
+              "pointer): "
+           << name << std::endl;
+    }
+  }
+
+  // Checks a global variable that all of a program's functions share (e.g.,
+  // one stored in the globals table of a program image).
+  void VisitGlobal(const VarPtr_t& var) {
+    if (var->name()[0] != '@') {
+      err_ << "Global variable names must start with '@': " << var->ToString()
+           << std::endl;
+      return;
+    }
+    ReportIfNonexistentStruct(var->type());
+    ReportIfNotToplevelType(var->type());
+    CheckIfGlobal(var);
   }
 
   void VisitFunction(const Function& function) override {
     curr_function_ = &function;
 
-    if (function.body().count("entry") == 0) {
+    if (function.FindBlock(util::Symbol("entry")) == nullptr) {
       err_ << "Function must have a basic block named 'entry': "
            << function.name() << std::endl;
     }
 
-    for (const auto& [label, bb] : function.body()) {
-      if (label != bb->label()) {
-        err_ << "Mismatched basic block labels: " << label << " mapped to "
-             << bb->label() << std::endl;
-      }
-    }
-
     set<VarPtr_t> params;
 
     for (const auto& param : function.parameters()) {
@@ -837,15 +1864,29 @@ class VerifyVisitor : public IrVisitor {
       return;
     }
 
+    // The program has already looked the field up if it exists.
+    if (program_ != nullptr && inst.field_index() >= 0) {
+      const StructLayout& layout = program_->structs()[inst.struct_id()];
+      if (!inst.lhs()->type().IsPtr() ||
+          inst.lhs()->type().Deref() !=
+              layout.fields()[inst.field_index()].type) {
+        err_ << "Type error: Result type must be a pointer to type of field: "
+             << Instruction(inst).ToString() << std::endl;
+      }
+      ReportIfUnassignable(inst.lhs());
+      return;
+    }
+
     string struct_type = inst.src_ptr()->type().GetStructName();
-    if (program_->struct_types().count(struct_type) == 0) return;
+    if (struct_types_->count(struct_type) == 0) return;
 
-    const map<string, Type>& fields = program_->struct_types().at(struct_type);
+    const map<string, Type>& fields = struct_types_->at(struct_type);
 
     if (!fields.count(inst.field_name())) {
       err_ << "Type error: mismatch between struct type and field name: "
            << Instruction(inst).ToString() << std::endl;
-    } else if (inst.lhs()->type().Deref() != fields.at(inst.field_name())) {
+    } else if (!inst.lhs()->type().IsPtr() ||
+               inst.lhs()->type().Deref() != fields.at(inst.field_name())) {
       err_ << "Type error: Result type must be a pointer to type of field: "
            << Instruction(inst).ToString() << std::endl;
     }
@@ -887,11 +1928,13 @@ class VerifyVisitor : public IrVisitor {
 
     CheckIfGlobal(inst.lhs());
 
-    if (program_->functions().count(inst.callee()) == 0) return;
+    if (function_types_->count(inst.callee()) == 0) return;
 
-    const Function& callee = (*program_)[inst.callee()];
+    // The callee's return type followed by its parameter types.
+    const vector<Type>& types =
+        function_types_->at(inst.callee()).GetFuncTypes();
 
-    if (callee.parameters().size() != inst.args().size()) {
+    if (inst.args().size() != types.size() - 1) {
       err_ << "Type error: incorrect number of call arguments: "
            << Instruction(inst).ToString() << std::endl;
     }
@@ -899,14 +1942,14 @@ class VerifyVisitor : public IrVisitor {
     for (int i = 0; i < inst.args().size(); i++) {
       CheckIfGlobal(inst.args()[i]);
 
-      if (i >= callee.parameters().size()) break;
-      if (inst.args()[i].GetType() != callee.parameters()[i]->type()) {
+      if (i + 1 >= types.size()) break;
+      if (inst.args()[i].GetType() != types[i + 1]) {
         err_ << "Type error: type of argument doesn't match type of parameter: "
              << Instruction(inst).ToString() << std::endl;
       }
     }
 
-    if (inst.lhs()->type() != callee.return_type()) {
+    if (inst.lhs()->type() != types[0]) {
       err_ << "Type error: function return type doesn't match left-hand side: "
            << Instruction(inst).ToString() << std::endl;
     }
@@ -962,7 +2005,7 @@ class VerifyVisitor : public IrVisitor {
   }
 
   void VisitInst(const JumpInst& inst) override {
-    if (curr_function_->body().count(inst.label()) == 0) {
+    if (inst.target() == nullptr) {
       err_ << "Basic block '" << bb_id_
            << "' jumps to nonexistent basic block '" << inst.label() << "'"
            << std::endl;
@@ -973,12 +2016,12 @@ class VerifyVisitor : public IrVisitor {
     ReportIfNonexistentStruct(inst.condition().GetType());
     CheckIfGlobal(inst.condition());
 
-    if (curr_function_->body().count(inst.label_true()) == 0) {
+    if (inst.target_true() == nullptr) {
       err_ << "Basic block '" << bb_id_
            << "' branches to nonexistent basic block '" << inst.label_true()
            << "'" << std::endl;
     }
-    if (curr_function_->body().count(inst.label_false()) == 0) {
+    if (inst.target_false() == nullptr) {
       err_ << "Basic block '" << bb_id_
            << "' branches to nonexistent basic block '" << inst.label_false()
            << "'" << std::endl;
@@ -998,13 +2041,31 @@ class VerifyVisitor : public IrVisitor {
  private:
   void ReportIfNonexistentStruct(const Type& type) {
     if (type.BaseKind() == Type::kStruct &&
-        program_->struct_types().count(type.GetStructName()) == 0 &&
+        struct_types_->count(type.GetStructName()) == 0 &&
         nonexistent_structs_.count(type.GetStructName()) == 0) {
       err_ << "Type uses nonexistent struct: " << type << std::endl;
       nonexistent_structs_.insert(type.GetStructName());
     }
   }
 
+  // Returns whether struct type 'outer' contains (rather than points to) the
+  // struct type 'name', directly or within other struct types. 'visited' holds
+  // the struct types already searched.
+  bool ContainsStruct(const string& outer, const string& name,
+                      set<string>& visited) {
+    if (!visited.insert(outer).second || struct_types_->count(outer) == 0) {
+      return false;
+    }
+    for (const auto& [fieldname, type] : struct_types_->at(outer)) {
+      if (!type.IsStruct()) continue;
+      if (type.GetStructName() == name ||
+          ContainsStruct(type.GetStructName(), name, visited)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   // Top-level values (i.e., stored in a program variable rather than in memory)
   // can only be integers or pointers.
   void ReportIfNotToplevelType(const Type& type) {
@@ -1015,7 +2076,7 @@ class VerifyVisitor : public IrVisitor {
 
   // Variables beginning with '@' are assigned their values by the language
   // runtime and never change.
-  void ReportIfUnassignable(VarPtr_t var) {
+  void ReportIfUnassignable(const VarPtr_t& var) {
     if (var->name()[0] == '@') {
       err_ << "Variables starting with '@' are special and cannot be assigned "
               "to or stored into"
@@ -1025,11 +2086,11 @@ class VerifyVisitor : public IrVisitor {
 
   // Check for global variables (those that start with '@') to make sure they
   // are used properly, and remember any global function pointers.
-  void CheckIfGlobal(VarPtr_t var) {
+  void CheckIfGlobal(const VarPtr_t& var) {
     if (var->name()[0] != '@' || var->name() == "@nullptr") return;
     string fun_name = var->name().substr(1);
 
-    if (program_->functions().count(fun_name) == 0) {
+    if (function_types_->count(fun_name) == 0) {
       err_ << "Global function pointer doesn't point to a real function: "
            << var->ToString() << std::endl;
     }
@@ -1054,8 +2115,17 @@ class VerifyVisitor : public IrVisitor {
   // The generated error messages.
   std::ostringstream err_;
 
-  // Program, function, and basic block identifiers.
+  // The program's struct types and function types (see SetContext()); when
+  // visiting a whole program the function types are in
+  // 'program_function_types_'.
+  const map<string, map<string, Type>>* struct_types_ = nullptr;
+  const map<string, Type>* function_types_ = nullptr;
+  map<string, Type> program_function_types_;
+
+  // The program being verified, if it is a whole program.
   const Program* program_ = nullptr;
+
+  // Function and basic block identifiers.
   const Function* curr_function_ = nullptr;
   const BasicBlock* curr_bb_ = nullptr;
   string bb_id_;
@@ -1071,6 +2141,42 @@ class VerifyVisitor : public IrVisitor {
 
 }  // namespace
 
+Type FunctionType(const Function& function) {
+  vector<Type> types{function.return_type()};
+  for (const auto& param : function.parameters()) {
+    types.push_back(param->type());
+  }
+  return Type::Function(types);
+}
+
+string VerifyFunction(const Function& function,
+                      const map<string, map<string, Type>>& struct_types,
+                      const map<string, Type>& function_types) {
+  VerifyVisitor verifier;
+  verifier.SetContext(struct_types, function_types);
+  function.Visit(&verifier);
+  return verifier.GetErrors();
+}
+
+string VerifyStructTypes(const map<string, map<string, Type>>& struct_types) {
+  const map<string, Type> no_functions;
+  VerifyVisitor verifier;
+  verifier.SetContext(struct_types, no_functions);
+  for (const auto& [name, fields] : struct_types) {
+    verifier.VisitStructType(name, fields);
+  }
+  return verifier.GetErrors();
+}
+
+string VerifyGlobals(const vector<VarPtr_t>& globals,
+                     const map<string, map<string, Type>>& struct_types,
+                     const map<string, Type>& function_types) {
+  VerifyVisitor verifier;
+  verifier.SetContext(struct_types, function_types);
+  for (const auto& var : globals) verifier.VisitGlobal(var);
+  return verifier.GetErrors();
+}
+
 string Program::VerifyIr() {
   VerifyVisitor verifier;
   this->Visit(&verifier);
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+
 #include "ir/irvisitor.h"
+#include "util/arena.h"
 #include "util/standard_includes.h"
+#include "util/symbol.h"
 
 namespace ir {
 
@@ -11,6 +15,11 @@ namespace ir {
 // is necessary to handle recursive types). We represent a type as (1) a level
 // of pointer indirection (0 for no indirection) and (2) the base type (i.e.,
 // int, struct, or function).
+//
+// Each distinct type is interned once in a process-wide table and a Type is
+// just a handle to its entry, so Types are cheap to copy, compare, and hash,
+// and PtrTo() and Deref() don't allocate once a pointer type has been seen.
+// Interned types are never freed. Thread-safe.
 class Type {
  public:
   // It's important that these are listed in the same order as the Base enum.
@@ -18,59 +27,56 @@ class Type {
   enum Base { kInt, kStruct, kFunc };
 
   // The default type is integer.
-  Type() : indirection_(0) {}
+  Type() : node_(&int_node_) {}
 
   // Returns the level of pointer indirection.
-  int indirection() const { return indirection_; }
+  int indirection() const;
 
   // Returns the variant containing the base type.
-  const TypeVariant& base_type() const { return base_type_; }
+  const TypeVariant& base_type() const;
 
   // Returns whether this type is the integer type.
-  bool IsInt() const {
-    return indirection_ == 0 &&
-           std::holds_alternative<std::monostate>(base_type_);
-  }
+  bool IsInt() const { return node_ == &int_node_; }
 
   // Returns whether this type contains any pointer indirection.
-  bool IsPtr() const { return indirection_ > 0; }
+  bool IsPtr() const { return indirection() > 0; }
 
   // Returns whether this type is a struct.
-  bool IsStruct() const { return indirection_ == 0 && BaseKind() == kStruct; }
+  bool IsStruct() const { return indirection() == 0 && BaseKind() == kStruct; }
 
   // Returns whether this type is a pointer to a struct.
   bool IsStructPtr() const {
-    return indirection_ == 1 && BaseKind() == kStruct;
+    return indirection() == 1 && BaseKind() == kStruct;
   }
 
   // Returns whether this type is a function pointer.
   bool IsFunctionPtr() const {
-    return indirection_ == 1 && BaseKind() == kFunc;
+    return indirection() == 1 && BaseKind() == kFunc;
   }
 
   // Returns whether the base type (i.e., ignoring any pointer indirection) is
   // an integer (kInt), struct (kStruct), or function (kFunc) type.
-  Base BaseKind() const { return static_cast<Base>(base_type_.index()); }
+  Base BaseKind() const { return static_cast<Base>(base_type().index()); }
 
   // If the base type is a struct, returns the name of the struct. FATALs if the
   // base type is not a struct.
-  const string& GetStructName() const { return std::get<string>(base_type_); }
+  const string& GetStructName() const { return std::get<string>(base_type()); }
 
   // If the base type is a function, returns a vector containing the return type
   // followed by the parameter types. FATALs if the base type is not a function.
   const vector<Type>& GetFuncTypes() const {
-    return std::get<vector<Type>>(base_type_);
+    return std::get<vector<Type>>(base_type());
   }
 
   // Return the type that is a pointer to this type.
-  Type PtrTo() const { return Type(indirection_ + 1, base_type_); }
+  Type PtrTo() const;
 
   // Return the type of a dereference of this type. FATALs if this type is not a
   // pointer.
-  Type Deref() const {
-    CHECK_GT(indirection_, 0) << "Cannot dereference a non-pointer";
-    return Type(indirection_ - 1, base_type_);
-  }
+  Type Deref() const;
+
+  // Returns a hash of this type (the same in every run of the program).
+  size_t Hash() const;
 
   string ToString() const;
 
@@ -84,15 +90,17 @@ class Type {
   // Get a struct type given its name.
   static Type Struct(const string& name) {
     CHECK_NE(name, "") << "Struct type name must be non-empty";
-    return Type(0, name);
+    return Type(InternStruct(name));
   }
 
   // Get a function type given its return type and parameter types.
-  static Type Function(const vector<Type>& types) { return Type(0, types); }
+  static Type Function(const vector<Type>& types) {
+    return Type(InternFunction(types));
+  }
 
+  // Since each type is interned only once, equal types have the same handle.
   friend inline bool operator==(const Type& type1, const Type& type2) {
-    return type1.indirection_ == type2.indirection_ &&
-           type1.base_type_ == type2.base_type_;
+    return type1.node_ == type2.node_;
   }
 
   friend inline bool operator!=(const Type& type1, const Type& type2) {
@@ -105,77 +113,136 @@ class Type {
   }
 
  private:
-  Type(int indirection, const TypeVariant& base_type)
-      : indirection_(indirection), base_type_(base_type) {
-    CHECK_GE(indirection_, 0) << "indirection must be non-negative";
-  }
+  // An interned type, and the table that owns them.
+  struct Node;
+  class Table;
+
+  explicit Type(const Node* node) : node_(node) {}
+
+  // Return the interned struct type, function type, or pointer to 'node',
+  // creating it if necessary.
+  static const Node* InternStruct(const string& name);
+  static const Node* InternFunction(const vector<Type>& types);
+  static const Node* InternPtrTo(const Node* node);
 
+  // The integer type, which isn't in the table so that Type() needs no lookup.
+  static const Node int_node_;
+
+  const Node* node_;
+};
+
+struct Type::Node {
   // The level of pointer indirection (0 for none).
-  int indirection_;
+  int indirection;
 
   // std::monostate means Integer type, string means Struct type (the string is
   // the name of the struct), and a vector means a function type (the vector
   // contains the function return type followed by the parameter types).
-  TypeVariant base_type_;
+  TypeVariant base_type;
+
+  // Computed from the contents rather than the address of the node, so that
+  // hashes (and so iteration orders) don't change from run to run.
+  size_t hash;
+
+  // The type with one less level of indirection; null if indirection is 0.
+  const Node* deref;
+
+  // The type with one more level of indirection, once it has been interned.
+  mutable std::atomic<const Node*> ptr_to;
 };
 
+inline int Type::indirection() const { return node_->indirection; }
+
+inline const Type::TypeVariant& Type::base_type() const {
+  return node_->base_type;
+}
+
+inline Type Type::PtrTo() const {
+  const Node* ptr_to = node_->ptr_to.load(std::memory_order_acquire);
+  if (ptr_to == nullptr) ptr_to = InternPtrTo(node_);
+  return Type(ptr_to);
+}
+
+inline Type Type::Deref() const {
+  CHECK_GT(indirection(), 0) << "Cannot dereference a non-pointer";
+  return Type(node_->deref);
+}
+
+inline size_t Type::Hash() const { return node_->hash; }
+
 // A program variable and its type.
 class Variable {
  public:
-  Variable(const string& name, const Type& type) : name_(name), type_(type) {
-    CHECK_NE(name, "") << "name must be non-empty";
+  Variable(util::Symbol name, const Type& type) : name_(name), type_(type) {
+    CHECK(!name.empty()) << "name must be non-empty";
   }
 
-  const string& name() const { return name_; }
+  Variable(const string& name, const Type& type)
+      : Variable(util::Symbol(name), type) {}
+
+  const string& name() const { return name_.str(); }
   const Type& type() const { return type_; }
 
-  string ToString() const { return name_ + ":" + type_.ToString(); }
+  // The interned name, for comparing and hashing names in constant time.
+  util::Symbol name_symbol() const { return name_; }
+
+  string ToString() const { return name() + ":" + type_.ToString(); }
 
  private:
-  string name_;
+  util::Symbol name_;
   Type type_;
 };
 
 // A convenient type alias. We use VarPtr_t to reference variables so that we
 // don't have a bunch of copies of exactly the same information, as well as to
-// distinguish between different variables with the same name.
+// distinguish between different variables with the same name. Accessors return
+// a const VarPtr_t& so that reading a program doesn't touch reference counts,
+// which would make threads reading the same program contend with each other.
+// The variables of a program read with ParseOptions::use_arena are owned by the
+// program's arena instead, and their VarPtr_ts are non-owning.
 using VarPtr_t = shared_ptr<const Variable>;
 
 // An instruction operand can be a variable or a constant value.
 class Operand {
  public:
-  Operand(VarPtr_t var) : op_(CHECK_NOTNULL(var)) {}
-  Operand(int value) : op_(value) {}
+  Operand(VarPtr_t var) : var_(CHECK_NOTNULL(std::move(var))) {}
+  Operand(int value) : var_(VarPtr_t(), EncodeInt(value)) {}
 
-  bool IsVariable() const { return std::holds_alternative<VarPtr_t>(op_); }
+  bool IsVariable() const { return !IsConstInt(); }
 
-  bool IsConstInt() const { return std::holds_alternative<int>(op_); }
+  bool IsConstInt() const {
+    return reinterpret_cast<uintptr_t>(var_.get()) & 1;
+  }
 
   const Type& GetType() const {
     if (IsConstInt()) return int_type_;
     return GetVar()->type();
   }
 
-  VarPtr_t GetVar() const {
-    auto varp = std::get_if<VarPtr_t>(&op_);
-    CHECK(varp != nullptr) << "Operand is not a variable";
-    return *varp;
+  const VarPtr_t& GetVar() const {
+    CHECK(IsVariable()) << "Operand is not a variable";
+    return var_;
   }
 
   int GetInt() const {
-    auto intp = std::get_if<int>(&op_);
-    CHECK(intp != nullptr) << "Operand is not an integer";
-    return *intp;
+    CHECK(IsConstInt()) << "Operand is not an integer";
+    return static_cast<int>(
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(var_.get()) >> 1));
   }
 
-  bool operator==(const Operand& other) const { return op_ == other.op_; }
+  bool operator==(const Operand& other) const {
+    return var_.get() == other.var_.get();
+  }
 
   // If the operand is a variable returns the result of calling 'func_var' on
-  // it, otherwise the operand is an integer and it returns the result of
-  // calling 'func_int' in it.
-  template <class ReturnTy>
-  ReturnTy Map(const std::function<ReturnTy(VarPtr_t)>& func_var,
-               const std::function<ReturnTy(int)>& func_int) const {
+  // it (as a const VarPtr_t&), otherwise the operand is an integer and it
+  // returns the result of calling 'func_int' in it. The callables are called
+  // directly rather than through std::function, and the variable isn't
+  // copied, so mapping an operand costs no allocation or reference count.
+  template <class FuncVar, class FuncInt>
+  auto Map(FuncVar&& func_var, FuncInt&& func_int) const
+      -> std::common_type_t<decltype(func_var(std::declval<const VarPtr_t&>())),
+                            decltype(func_int(0))> {
     if (IsConstInt()) return func_int(GetInt());
     return func_var(GetVar());
   }
@@ -186,11 +253,24 @@ class Operand {
   }
 
  private:
+  static_assert(sizeof(uintptr_t) > sizeof(uint32_t),
+                "Integer operands are stored in a pointer with a tag bit");
+
+  static const Variable* EncodeInt(int value) {
+    uintptr_t bits = static_cast<uint32_t>(value);
+    return reinterpret_cast<const Variable*>(bits << 1 | 1);
+  }
+
   // The type to return when holding an integer constant (so that we don't have
   // to keep creating it whenever GetType() is called).
   inline static Type int_type_ = Type::Int();
 
-  variant<VarPtr_t, int> op_;
+  // Either the variable, or for an integer constant a pointer with no owner
+  // whose value is the integer shifted left one bit with the low bit set
+  // (variables are aligned, so their addresses never have it set). This keeps
+  // an operand the size of a VarPtr_t, and copying an integer operand doesn't
+  // touch a reference count.
+  VarPtr_t var_;
 };
 
 // Arithmetic: "lhs = op1 'operation' op2".
@@ -200,9 +280,12 @@ class ArithInst {
   enum Aop { kAdd, kSubtract, kMultiply, kDivide };
 
   ArithInst(VarPtr_t lhs, const Operand& op1, const Operand& op2, Aop operation)
-      : lhs_(CHECK_NOTNULL(lhs)), op1_(op1), op2_(op2), operation_(operation) {}
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        op1_(op1),
+        op2_(op2),
+        operation_(operation) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
   const Operand& op1() const { return op1_; }
   const Operand& op2() const { return op2_; }
   Aop operation() const { return operation_; }
@@ -227,9 +310,12 @@ class CmpInst {
   };
 
   CmpInst(VarPtr_t lhs, const Operand& op1, const Operand& op2, Rop operation)
-      : lhs_(CHECK_NOTNULL(lhs)), op1_(op1), op2_(op2), operation_(operation) {}
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        op1_(op1),
+        op2_(op2),
+        operation_(operation) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
   const Operand& op1() const { return op1_; }
   const Operand& op2() const { return op2_; }
   Rop operation() const { return operation_; }
@@ -244,10 +330,10 @@ class CmpInst {
 // block the execution came from.
 class PhiInst {
  public:
-  PhiInst(VarPtr_t lhs, const vector<Operand>& ops)
-      : lhs_(CHECK_NOTNULL(lhs)), ops_(ops) {}
+  PhiInst(VarPtr_t lhs, vector<Operand> ops)
+      : lhs_(CHECK_NOTNULL(std::move(lhs))), ops_(std::move(ops)) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
   const vector<Operand>& ops() const { return ops_; }
 
  private:
@@ -259,9 +345,9 @@ class PhiInst {
 class CopyInst {
  public:
   CopyInst(VarPtr_t lhs, const Operand& rhs)
-      : lhs_(CHECK_NOTNULL(lhs)), rhs_(rhs) {}
+      : lhs_(CHECK_NOTNULL(std::move(lhs))), rhs_(rhs) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
   const Operand& rhs() const { return rhs_; }
 
  private:
@@ -274,9 +360,9 @@ class CopyInst {
 // allocated is left unspecified (i.e., it could be an array of things).
 class AllocInst {
  public:
-  explicit AllocInst(VarPtr_t lhs) : lhs_(CHECK_NOTNULL(lhs)) {}
+  explicit AllocInst(VarPtr_t lhs) : lhs_(CHECK_NOTNULL(std::move(lhs))) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
 
  private:
   VarPtr_t lhs_;
@@ -286,10 +372,11 @@ class AllocInst {
 class AddrOfInst {
  public:
   AddrOfInst(VarPtr_t lhs, VarPtr_t rhs)
-      : lhs_(CHECK_NOTNULL(lhs)), rhs_(CHECK_NOTNULL(rhs)) {}
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        rhs_(CHECK_NOTNULL(std::move(rhs))) {}
 
-  VarPtr_t lhs() const { return lhs_; }
-  VarPtr_t rhs() const { return rhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
+  const VarPtr_t& rhs() const { return rhs_; }
 
  private:
   VarPtr_t lhs_, rhs_;
@@ -299,10 +386,11 @@ class AddrOfInst {
 class LoadInst {
  public:
   LoadInst(VarPtr_t lhs, VarPtr_t src)
-      : lhs_(CHECK_NOTNULL(lhs)), src_(CHECK_NOTNULL(src)) {}
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        src_(CHECK_NOTNULL(std::move(src))) {}
 
-  VarPtr_t lhs() const { return lhs_; }
-  VarPtr_t src() const { return src_; }
+  const VarPtr_t& lhs() const { return lhs_; }
+  const VarPtr_t& src() const { return src_; }
 
  private:
   VarPtr_t lhs_, src_;
@@ -312,9 +400,9 @@ class LoadInst {
 class StoreInst {
  public:
   StoreInst(VarPtr_t dst, const Operand& value)
-      : dst_(CHECK_NOTNULL(dst)), value_(value) {}
+      : dst_(CHECK_NOTNULL(std::move(dst))), value_(value) {}
 
-  VarPtr_t dst() const { return dst_; }
+  const VarPtr_t& dst() const { return dst_; }
   const Operand& value() const { return value_; }
 
  private:
@@ -333,21 +421,38 @@ class StoreInst {
 class GepInst {
  public:
   GepInst(VarPtr_t lhs, VarPtr_t src_ptr, const Operand& index,
-          const string& field_name)
-      : lhs_(CHECK_NOTNULL(lhs)),
-        src_ptr_(CHECK_NOTNULL(src_ptr)),
+          util::Symbol field_name)
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        src_ptr_(CHECK_NOTNULL(std::move(src_ptr))),
         index_(index),
         field_name_(field_name) {}
 
-  VarPtr_t lhs() const { return lhs_; }
-  VarPtr_t src_ptr() const { return src_ptr_; }
+  GepInst(VarPtr_t lhs, VarPtr_t src_ptr, const Operand& index,
+          const string& field_name)
+      : GepInst(std::move(lhs), std::move(src_ptr), index,
+                util::Symbol(field_name)) {}
+
+  const VarPtr_t& lhs() const { return lhs_; }
+  const VarPtr_t& src_ptr() const { return src_ptr_; }
   const Operand& index() const { return index_; }
-  const string& field_name() const { return field_name_; }
+  const string& field_name() const { return field_name_.str(); }
+  util::Symbol field_name_symbol() const { return field_name_; }
+
+  // Return the index of the struct type that 'src_ptr' points to in
+  // Program::structs(), and of the field within its StructLayout::fields(), as
+  // resolved by the program containing the instruction; -1 if the instruction
+  // isn't in a program or has no such field.
+  int struct_id() const { return struct_id_; }
+  int field_index() const { return field_index_; }
 
  private:
+  friend class Program;
+
   VarPtr_t lhs_, src_ptr_;
   Operand index_;
-  string field_name_;
+  util::Symbol field_name_;
+  int struct_id_ = -1;
+  int field_index_ = -1;
 };
 
 // Ternary operator: "lhs = (condition ? true_op : false_op)".
@@ -355,12 +460,12 @@ class SelectInst {
  public:
   SelectInst(VarPtr_t lhs, const Operand& condition, const Operand& true_op,
              const Operand& false_op)
-      : lhs_(CHECK_NOTNULL(lhs)),
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
         condition_(condition),
         true_op_(true_op),
         false_op_(false_op) {}
 
-  VarPtr_t lhs() const { return lhs_; }
+  const VarPtr_t& lhs() const { return lhs_; }
   const Operand& condition() const { return condition_; }
   const Operand& true_op() const { return true_op_; }
   const Operand& false_op() const { return false_op_; }
@@ -373,29 +478,54 @@ class SelectInst {
 // Direct function call: "lhs = func_name(args)".
 class CallInst {
  public:
-  CallInst(VarPtr_t lhs, const string& callee, const vector<Operand>& args)
-      : lhs_(CHECK_NOTNULL(lhs)), callee_(callee), args_(args) {}
+  CallInst(VarPtr_t lhs, util::Symbol callee, vector<Operand> args)
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        callee_(callee),
+        args_(std::move(args)) {}
+
+  CallInst(VarPtr_t lhs, const string& callee, vector<Operand> args)
+      : CallInst(std::move(lhs), util::Symbol(callee), std::move(args)) {}
+
+  // A copy isn't in the program of the original (which may not outlive it),
+  // so its target is unresolved until it is put into a program.
+  CallInst(const CallInst& inst)
+      : lhs_(inst.lhs_), callee_(inst.callee_), args_(inst.args_) {}
+  CallInst(CallInst&& inst) noexcept = default;
+
+  CallInst& operator=(const CallInst& inst) {
+    return *this = CallInst(inst);
+  }
+  CallInst& operator=(CallInst&& inst) noexcept = default;
 
-  VarPtr_t lhs() const { return lhs_; }
-  const string& callee() const { return callee_; }
+  const VarPtr_t& lhs() const { return lhs_; }
+  const string& callee() const { return callee_.str(); }
+  util::Symbol callee_symbol() const { return callee_; }
   const vector<Operand>& args() const { return args_; }
 
+  // Returns the function called, as resolved by the program containing the
+  // call; nullptr if the call isn't in a program or the callee is defined
+  // outside of it (e.g., 'input', 'output', 'malloc').
+  const Function* target() const { return target_; }
+
  private:
+  friend class Program;
+
   VarPtr_t lhs_;
-  string callee_;
+  util::Symbol callee_;
   vector<Operand> args_;
+  const Function* target_ = nullptr;
 };
 
 // Indirect function call: "lhs = (*func_ptr)(args)".
 class ICallInst {
  public:
-  ICallInst(VarPtr_t lhs, VarPtr_t func_ptr, const vector<Operand>& args)
-      : lhs_(CHECK_NOTNULL(lhs)),
-        func_ptr_(CHECK_NOTNULL(func_ptr)),
-        args_(args) {}
+  ICallInst(VarPtr_t lhs, VarPtr_t func_ptr, vector<Operand> args)
+      : lhs_(CHECK_NOTNULL(std::move(lhs))),
+        func_ptr_(CHECK_NOTNULL(std::move(func_ptr))),
+        args_(std::move(args)) {}
 
-  VarPtr_t lhs() const { return lhs_; }
-  VarPtr_t func_ptr() const { return func_ptr_; }
+  const VarPtr_t& lhs() const { return lhs_; }
+  const VarPtr_t& func_ptr() const { return func_ptr_; }
   const vector<Operand>& args() const { return args_; }
 
  private:
@@ -417,30 +547,56 @@ class RetInst {
 // Jump to basic block.
 class JumpInst {
  public:
+  explicit JumpInst(util::Symbol label) : label_(label) {}
   explicit JumpInst(const string& label) : label_(label) {}
 
-  const string& label() const { return label_; }
+  const string& label() const { return label_.str(); }
+  util::Symbol label_symbol() const { return label_; }
+
+  // Returns the basic block with the label, as resolved by the containing
+  // function; nullptr if the jump isn't in a function or there is no such
+  // block.
+  const BasicBlock* target() const { return target_; }
 
  private:
-  string label_;
+  friend class Function;
+
+  util::Symbol label_;
+  const BasicBlock* target_ = nullptr;
 };
 
 // Branch to one of two basic blocks depending on condition.
 class BranchInst {
  public:
-  BranchInst(const Operand& condition, const string& label_true,
-             const string& label_false)
+  BranchInst(const Operand& condition, util::Symbol label_true,
+             util::Symbol label_false)
       : condition_(condition),
         label_true_(label_true),
         label_false_(label_false) {}
 
+  BranchInst(const Operand& condition, const string& label_true,
+             const string& label_false)
+      : BranchInst(condition, util::Symbol(label_true),
+                   util::Symbol(label_false)) {}
+
   const Operand& condition() const { return condition_; }
-  const string& label_true() const { return label_true_; }
-  const string& label_false() const { return label_false_; }
+  const string& label_true() const { return label_true_.str(); }
+  const string& label_false() const { return label_false_.str(); }
+  util::Symbol label_true_symbol() const { return label_true_; }
+  util::Symbol label_false_symbol() const { return label_false_; }
+
+  // Return the basic blocks with the labels, as resolved by the containing
+  // function (see JumpInst::target()).
+  const BasicBlock* target_true() const { return target_true_; }
+  const BasicBlock* target_false() const { return target_false_; }
 
  private:
+  friend class Function;
+
   Operand condition_;
-  string label_true_, label_false_;
+  util::Symbol label_true_, label_false_;
+  const BasicBlock* target_true_ = nullptr;
+  const BasicBlock* target_false_ = nullptr;
 };
 
 // A forward reference because instructions have a pointer to their enclosing
@@ -468,36 +624,36 @@ class Instruction {
     kBranch,
   };
 
-  Instruction(const ArithInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const CmpInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const PhiInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const CopyInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const AllocInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const AddrOfInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const LoadInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const StoreInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const GepInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const SelectInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const CallInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const ICallInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const RetInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const JumpInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
-  Instruction(const BranchInst& inst, const BasicBlock* parent = nullptr)
-      : inst_(inst), parent_(parent) {}
+  Instruction(ArithInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(CmpInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(PhiInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(CopyInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(AllocInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(AddrOfInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(LoadInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(StoreInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(GepInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(SelectInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(CallInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(ICallInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(RetInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(JumpInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
+  Instruction(BranchInst inst, const BasicBlock* parent = nullptr)
+      : inst_(std::move(inst)), parent_(parent) {}
   Instruction(const Instruction& inst, const BasicBlock* parent)
       : inst_(inst.inst_), parent_(parent) {}
 
@@ -507,6 +663,10 @@ class Instruction {
   // there is one (otherwise returns -1).
   int GetIndex() const;
 
+  // Returns the id of this instruction within its containing function (see
+  // Function::instructions()), if there is one (otherwise returns -1).
+  int id() const;
+
   // Return the containing basic block, if there is one (otherwise returns
   // nullptr).
   const BasicBlock* parent() const { return parent_; }
@@ -547,6 +707,13 @@ class Instruction {
           RetInst, JumpInst, BranchInst>
       inst_;
 
+  // Basic blocks set the parent pointers of the instructions moved into them,
+  // functions resolve the targets of jumps and branches, and programs resolve
+  // the targets of calls.
+  friend class BasicBlock;
+  friend class Function;
+  friend class Program;
+
   // If non-null, points to the containing basic block.
   const BasicBlock* parent_;
 };
@@ -556,18 +723,41 @@ class Instruction {
 // containing function) label.
 class BasicBlock {
  public:
+  BasicBlock(util::Symbol label, const vector<Instruction>& body,
+             const Function* parent = nullptr);
+
   BasicBlock(const string& label, const vector<Instruction>& body,
+             const Function* parent = nullptr)
+      : BasicBlock(util::Symbol(label), body, parent) {}
+
+  // Like the above, but moves the instructions instead of copying them.
+  BasicBlock(util::Symbol label, vector<Instruction>&& body,
              const Function* parent = nullptr);
 
+  BasicBlock(const string& label, vector<Instruction>&& body,
+             const Function* parent = nullptr)
+      : BasicBlock(util::Symbol(label), std::move(body), parent) {}
+
   BasicBlock(const BasicBlock& bb);
 
-  const string& label() const { return label_; }
+  // Moves the instructions of 'bb' instead of copying them, leaving 'bb' empty.
+  BasicBlock(BasicBlock&& bb) noexcept;
+
+  BasicBlock& operator=(const BasicBlock& bb);
+  BasicBlock& operator=(BasicBlock&& bb) noexcept;
+
+  const string& label() const { return label_.str(); }
+  util::Symbol label_symbol() const { return label_; }
   const vector<Instruction>& body() const { return body_; }
 
   // If this basic block is not contained within a function then its parent is a
   // nullptr.
   const Function* parent() const { return parent_; }
 
+  // Returns the id of this basic block within its containing function (see
+  // Function::blocks()), if there is one (otherwise returns -1).
+  int id() const { return id_; }
+
   // Returns the instruction at the given index within the basic block; FATALs
   // if the index is not within bounds.
   const Instruction& operator[](int index) const;
@@ -583,13 +773,33 @@ class BasicBlock {
   static BasicBlock FromString(const string& basic_block);
 
  private:
-  string label_;
+  // The containing function numbers its basic blocks and instructions, and
+  // each instruction's id is derived from its block's.
+  friend class Function;
+  friend class Instruction;
+
+  util::Symbol label_;
   vector<Instruction> body_;
   const Function* parent_;
+
+  // The id of this basic block and of its first instruction within the
+  // containing function (-1 if there is none).
+  int id_ = -1;
+  int first_inst_id_ = -1;
 };
 
-// A convenient type alias. We use BbPtr_t to reference basic blocks so that
-// their address doesn't change when a function or program is copied.
+inline int Instruction::id() const {
+  if (parent_ == nullptr || parent_->first_inst_id_ < 0) return -1;
+  return parent_->first_inst_id_ + GetIndex();
+}
+
+class Cfg;
+class CompactCode;
+class ControlDependence;
+class DominatorTree;
+
+// A convenient type alias, for the basic blocks of a function by label (see
+// Function::body()).
 using BbPtr_t = shared_ptr<const BasicBlock>;
 
 // A function.
@@ -597,20 +807,112 @@ class Function {
  public:
   // 'body' should contains a basic block with the label "entry", which is the
   // entry point to the function.
-  Function(const string& name, const Type& return_type,
+  Function(util::Symbol name, const Type& return_type,
            const vector<VarPtr_t>& parameters, const vector<BasicBlock>& body);
 
+  Function(const string& name, const Type& return_type,
+           const vector<VarPtr_t>& parameters, const vector<BasicBlock>& body)
+      : Function(util::Symbol(name), return_type, parameters, body) {}
+
+  // Like the above, but moves the basic blocks (and their instructions)
+  // instead of copying them.
+  Function(util::Symbol name, const Type& return_type,
+           const vector<VarPtr_t>& parameters, vector<BasicBlock>&& body);
+
+  Function(const string& name, const Type& return_type,
+           const vector<VarPtr_t>& parameters, vector<BasicBlock>&& body)
+      : Function(util::Symbol(name), return_type, parameters,
+                 std::move(body)) {}
+
   Function(const Function& fun);
 
-  const string& name() const { return name_; }
+  // Takes over the basic blocks of 'fun' instead of copying them; 'fun' may
+  // only be destroyed or assigned to afterwards.
+  Function(Function&& fun) noexcept;
+
+  Function& operator=(const Function& fun);
+  Function& operator=(Function&& fun) noexcept;
+
+  ~Function();
+
+  const string& name() const { return name_.str(); }
+  util::Symbol name_symbol() const { return name_; }
   const Type& return_type() const { return return_type_; }
   const vector<VarPtr_t>& parameters() const { return parameters_; }
-  const map<string, BbPtr_t>& body() const { return body_; }
+
+  // Returns the basic blocks by label, building the map the first time it's
+  // requested. Thread-safe. Each pointer shares ownership of all the blocks in
+  // layout(), so the blocks outlive the function if the pointer does (although
+  // their parent() doesn't, so the blocks' targets and ids should no longer be
+  // relied on then).
+  const map<string, BbPtr_t>& body() const;
+
+  // Returns the basic blocks in layout order: the entry block first, and then
+  // the others in the order they were given (i.e., the order of the text or
+  // that the builder added them in), which is usually close to a topological
+  // order. The blocks are stored contiguously.
+  const vector<BasicBlock>& layout() const { return *layout_; }
 
   // Returns the basic block with the given label; FATALs if no such basic block
   // exists.
   const BasicBlock& operator[](const string& label) const;
 
+  // Returns the basic block with the given label, or nullptr if there is none.
+  const BasicBlock* FindBlock(util::Symbol label) const {
+    const int* id = block_ids_.Find(label);
+    return id == nullptr ? nullptr : &(*layout_)[*id];
+  }
+
+  // The basic blocks, instructions, and local variables of a function are each
+  // numbered densely from 0, so that analyses can keep per-block,
+  // per-instruction, or per-variable state in vectors and bitsets rather than
+  // in hash tables keyed by pointers.
+
+  // Returns the basic blocks indexed by id (see BasicBlock::id()). Blocks are
+  // numbered in layout order (see layout()).
+  const vector<const BasicBlock*>& blocks() const { return blocks_; }
+
+  // Returns the instructions indexed by id (see Instruction::id()). The
+  // instructions of each block are numbered in order, following the blocks.
+  const vector<const Instruction*>& instructions() const { return insts_; }
+
+  // Returns the local variables indexed by id: the parameters, followed by the
+  // other variables not starting with '@' in the order they first appear. The
+  // variables are owned by the parameters and instructions that use them.
+  const vector<const Variable*>& locals() const;
+
+  // Returns the id of 'var' in locals(), or -1 if it isn't a local variable of
+  // this function.
+  int LocalId(const Variable* var) const;
+
+  // Returns the call instructions (direct and indirect) in this function, in
+  // order of id.
+  const vector<const Instruction*>& call_sites() const { return call_sites_; }
+
+  // Returns the direct calls to this function from the program containing it
+  // (see CallInst::target()), ordered by the name of the calling function and
+  // then by id; empty if this function isn't in a program.
+  const vector<const Instruction*>& callers() const { return callers_; }
+
+  // Returns the control-flow graph of this function, computing it the first
+  // time it's requested (see ir/cfg.h). Thread-safe.
+  const Cfg& cfg() const;
+
+  // Returns the dominator tree of cfg(), computing it the first time it's
+  // requested (see ir/dominators.h). Thread-safe.
+  const DominatorTree& dominators() const;
+
+  // Like the above, but for the reverse of cfg() (see Cfg::Reverse()), its
+  // dominator tree (i.e., the post-dominator tree), and the control
+  // dependence graph (see ir/control_dependence.h).
+  const Cfg& reverse_cfg() const;
+  const DominatorTree& post_dominators() const;
+  const ControlDependence& control_dependence() const;
+
+  // Returns the instructions encoded as compact records, encoding them the
+  // first time they're requested (see ir/compact_code.h). Thread-safe.
+  const CompactCode& compact_code() const;
+
   void Visit(IrVisitor* visitor) const;
 
   string ToString() const;
@@ -622,18 +924,234 @@ class Function {
   static Function FromString(const string& function);
 
  private:
-  string name_;
+  util::Symbol name_;
   Type return_type_;
   vector<VarPtr_t> parameters_;
 
-  // Basic block id ==> basic block.
-  map<string, BbPtr_t> body_;
+  // Moves 'bb' to the end of 'layout_', numbering it and its instructions.
+  // 'layout_' must have room for it, so that the blocks already added stay
+  // put.
+  void AddBlock(BasicBlock&& bb);
+
+  // Numbers the local variables, once all the basic blocks have been added.
+  void NumberLocals();
+
+  // Fills in 'block_ids_' and 'label_order_' from 'layout_', and then the
+  // targets of the jumps and branches from 'block_ids_'.
+  void IndexBlocks();
+
+  // The basic blocks in layout order (see layout()); a block's index is its
+  // id. They're shared with the pointers in body(), and a move takes them
+  // over.
+  shared_ptr<vector<BasicBlock>> layout_ = make_shared<vector<BasicBlock>>();
+
+  // Basic block label ==> id.
+  util::SymbolMap<int> block_ids_;
+
+  // The ids of the basic blocks in order of label, which is the order that
+  // Visit() (and so ToString()) goes through them in.
+  vector<int> label_order_;
+
+  // Id ==> basic block or instruction.
+  vector<const BasicBlock*> blocks_;
+  vector<const Instruction*> insts_;
+
+  // The local variables and their ids. They don't change when a function is
+  // copied, so copies share them.
+  struct LocalTable;
+  shared_ptr<const LocalTable> locals_;
+
+  // The arena that the variables are allocated in, if the function was read
+  // as part of a program with ParseOptions::use_arena. Copies share it.
+  shared_ptr<const util::Arena> arena_;
+
+  // See call_sites() and callers(). The containing program fills in the
+  // latter.
+  friend class Program;
+  vector<const Instruction*> call_sites_;
+  vector<const Instruction*> callers_;
+
+  // An object built from the function the first time it's requested (see
+  // cfg() and the like) and then owned by it. A copy of the function starts
+  // out without the object, while a move takes it over, so that the function
+  // stays copyable and assignable. Building is thread-safe: threads that find
+  // the object missing at the same time each build one, and the first to
+  // finish installs theirs. Only instantiated in ir.cc, where T is complete.
+  template <typename T>
+  class Cached {
+   public:
+    Cached() = default;
+    Cached(const Cached&) {}
+    Cached(Cached&& other) noexcept : ptr_(other.ptr_.exchange(nullptr)) {}
+    ~Cached() { delete ptr_.load(); }
+
+    Cached& operator=(const Cached& other) {
+      if (this != &other) delete ptr_.exchange(nullptr);
+      return *this;
+    }
+
+    Cached& operator=(Cached&& other) noexcept {
+      if (this != &other) delete ptr_.exchange(other.ptr_.exchange(nullptr));
+      return *this;
+    }
+
+    // Returns the object, first building it with build() (which returns a
+    // unique_ptr<const T>) if there isn't one.
+    template <typename Build>
+    const T& Get(Build&& build) const {
+      const T* cached = ptr_.load(std::memory_order_acquire);
+      if (cached != nullptr) return *cached;
+
+      unique_ptr<const T> built = build();
+      if (ptr_.compare_exchange_strong(cached, built.get(),
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+        return *built.release();
+      }
+      return *cached;
+    }
+
+   private:
+    mutable std::atomic<const T*> ptr_{nullptr};
+  };
+
+  // The control-flow graphs, dominator trees, and control dependence graph,
+  // once they have been computed. A move can take them over since they only
+  // refer to blocks by id.
+  Cached<Cfg> cfg_;
+  Cached<DominatorTree> dominators_;
+  Cached<Cfg> reverse_cfg_;
+  Cached<DominatorTree> post_dominators_;
+  Cached<ControlDependence> control_dependence_;
+
+  // See compact_code(), which only refers to blocks by id too.
+  Cached<CompactCode> compact_code_;
+
+  // See body().
+  Cached<map<string, BbPtr_t>> blocks_by_label_;
 };
 
+struct Function::LocalTable {
+  // Id ==> local variable.
+  vector<const Variable*> vars;
+
+  // Local variable ==> id, as an open-addressing hash table of ids (-1 for an
+  // empty slot) whose size is a power of two and that is at most half full.
+  vector<int> slots;
+
+  // Returns the id of 'var', or -1 if it isn't in the table.
+  int Find(const Variable* var) const { return slots[Slot(var)]; }
+
+  // Returns the slot holding the id of 'var', or the empty slot where it would
+  // go.
+  size_t Slot(const Variable* var) const {
+    const size_t mask = slots.size() - 1;
+    size_t slot = (reinterpret_cast<uintptr_t>(var) >> 4) * 0x9e3779b97f4a7c15;
+    for (slot = (slot >> 32) & mask; slots[slot] >= 0;
+         slot = (slot + 1) & mask) {
+      if (vars[slots[slot]] == var) break;
+    }
+    return slot;
+  }
+};
+
+inline const vector<const Variable*>& Function::locals() const {
+  return locals_->vars;
+}
+
+inline int Function::LocalId(const Variable* var) const {
+  return locals_->Find(var);
+}
+
 // A convenient type alias. We use FuncPtr_t to reference functions so that
 // their address doesn't change when a program is copied.
 using FuncPtr_t = shared_ptr<const Function>;
 
+// Returns the type of 'function' (i.e., a function type made from its return
+// type and parameter types).
+Type FunctionType(const Function& function);
+
+// Returns the problems that Program::VerifyIr() would find with 'function' (or
+// the empty string if there are none) if it were part of a program with the
+// given struct types and functions (function name ==> function type). This
+// allows a program's functions to be verified one at a time.
+string VerifyFunction(const Function& function,
+                      const map<string, map<string, Type>>& struct_types,
+                      const map<string, Type>& function_types);
+
+// Returns the problems that Program::VerifyIr() would find with the given
+// struct types (or the empty string if there are none), for verifying a
+// program's functions one at a time (see VerifyFunction()).
+string VerifyStructTypes(const map<string, map<string, Type>>& struct_types);
+
+// Returns the problems that Program::VerifyIr() would find with global
+// variables shared by all the functions of a program with the given struct
+// types and functions (or the empty string if there are none): each must be a
+// null pointer or a pointer to one of the functions, and there must be only
+// one variable for each function.
+string VerifyGlobals(const vector<VarPtr_t>& globals,
+                     const map<string, map<string, Type>>& struct_types,
+                     const map<string, Type>& function_types);
+
+// Options for reading a program from text.
+struct ParseOptions {
+  // The number of threads to parse functions on (0 means one per hardware
+  // thread). The result is the same regardless.
+  int num_threads = 1;
+
+  // Whether to allocate all of the program's variables (local and global) in
+  // one arena owned by the program (see util::Arena) rather than one at a
+  // time. The arena, rather than the VarPtr_ts, owns the variables: the
+  // VarPtr_ts don't count references, and freeing the variables costs one
+  // free() per chunk. Each function read this way shares ownership of the
+  // arena, as do its copies, so a VarPtr_t is valid as long as the program or
+  // a copy of one of its functions is; one kept beyond that dangles. The
+  // functions, basic blocks, and instructions themselves, and the vectors
+  // they're made of, are allocated as usual.
+  bool use_arena = false;
+};
+
+// A struct type, with its fields indexed densely in the order of
+// Program::struct_types() (i.e., by name) and laid out in abstract units: an
+// int or pointer takes up one unit, and a field of struct type (rather than
+// pointer to struct type) takes up the units of that struct type in turn.
+class StructLayout {
+ public:
+  struct Field {
+    util::Symbol name;
+    Type type;
+
+    // The offset of the field's first unit within the struct.
+    int offset;
+  };
+
+  util::Symbol name() const { return name_; }
+  const vector<Field>& fields() const { return fields_; }
+
+  // Returns the index in fields() of the field with the given name, or -1 if
+  // there is none.
+  int FieldIndex(util::Symbol name) const {
+    const int* index = field_indices_.Find(name);
+    return index == nullptr ? -1 : *index;
+  }
+
+  // Returns the type of each unit of the struct (none of which is a struct
+  // type), indexed by offset.
+  const vector<Type>& units() const { return units_; }
+
+  // Returns the number of units in the struct.
+  int size() const { return units_.size(); }
+
+ private:
+  // Programs build the layouts of their struct types.
+  friend class Program;
+
+  util::Symbol name_;
+  vector<Field> fields_;
+  util::SymbolMap<int> field_indices_;
+  vector<Type> units_;
+};
+
 // A program.
 class Program {
  public:
@@ -643,6 +1161,10 @@ class Program {
   Program(const map<string, map<string, Type>>& struct_types,
           const vector<Function>& functions);
 
+  // Like the above, but moves the functions instead of copying them.
+  Program(const map<string, map<string, Type>>& struct_types,
+          vector<Function>&& functions);
+
   void Visit(IrVisitor* visitor) const;
 
   const map<string, map<string, Type>>& struct_types() const {
@@ -651,6 +1173,16 @@ class Program {
 
   const map<string, FuncPtr_t>& functions() const { return functions_; }
 
+  // Returns the struct types indexed densely in the order of struct_types(),
+  // with their fields indexed and laid out.
+  const vector<StructLayout>& structs() const { return structs_; }
+
+  // Returns the struct type with the given name, or nullptr if there is none.
+  const StructLayout* FindStruct(util::Symbol name) const {
+    const int* id = structs_by_name_.Find(name);
+    return id == nullptr ? nullptr : &structs_[*id];
+  }
+
   // Returns global function pointers for those functions whose address has been
   // taken (i.e., may not contain pointers to all functions).
   const map<string, VarPtr_t>& func_ptrs() const { return func_ptrs_; }
@@ -659,11 +1191,54 @@ class Program {
   // exists.
   const Function& operator[](const string& name) const;
 
+  // Returns the function with the given name, or nullptr if there is none.
+  const Function* FindFunction(util::Symbol name) const {
+    const Function* const* function = functions_by_name_.Find(name);
+    return function == nullptr ? nullptr : *function;
+  }
+
   string ToString() const;
 
+  // Writes the same text as ToString() to 'out' without building it up as a
+  // string first.
+  void WriteTo(std::ostream& out) const;
+
+  // Writes the same text as ToString() to the file at 'path', creating or
+  // truncating it, through a fixed-size buffer; FATALs if it can't be written.
+  void WriteToFile(const string& path) const;
+
   // Returns a program read from a string in the same format as that output by
   // ToString().
-  static Program FromString(const string& program);
+  static Program FromString(const string& program,
+                            const ParseOptions& options = {});
+
+  // Like FromString(), but if 'program' is malformed returns nullopt and sets
+  // 'errors' to what is wrong with it instead of FATALing. Each malformed
+  // struct type or function is reported with a line number; if there are no
+  // such syntax errors then any problems found by verifying the program are
+  // reported instead.
+  static optional<Program> Parse(const string& program, vector<string>* errors,
+                                 const ParseOptions& options = {});
+
+  // Returns the program in a compact, versioned binary format (see
+  // ir_binary.h) that DeserializeBinary() reads much faster than FromString()
+  // reads text.
+  string SerializeBinary() const;
+
+  // Returns a program read from the output of SerializeBinary(); FATALs if
+  // 'data' is malformed or of an unsupported version.
+  static Program DeserializeBinary(std::string_view data);
+
+  // Returns a program read from the file at 'path', in the same format as that
+  // output by ToString(). The file is memory-mapped and parsed in place rather
+  // than first being copied into a string; FATALs if it can't be read.
+  static Program FromFile(const string& path, const ParseOptions& options = {});
+
+  // Returns a program read from 'in', in the same format as that output by
+  // ToString(). The input is read 'chunk_size' bytes at a time and each struct
+  // type or function definition is parsed as soon as it has been read, so only
+  // about one definition's worth of text is held in memory at any time.
+  static Program FromStream(std::istream& in, size_t chunk_size = 1 << 16);
 
  private:
   // Returns an error message if the program is malformed; an empty result means
@@ -671,19 +1246,59 @@ class Program {
   // along the way.
   string VerifyIr();
 
+  // Like the public constructor, but if 'errors' is non-null then instead of
+  // FATALing if the program is malformed, sets 'errors' to the problems found
+  // (empty if there are none). 'arena' is where the functions' variables were
+  // allocated, if they were read with ParseOptions::use_arena.
+  Program(const map<string, map<string, Type>>& struct_types,
+          vector<Function>&& functions, string* errors,
+          shared_ptr<const util::Arena> arena = nullptr);
+
+  // Reads a program as specified by 'options'; FATALs if it is malformed.
+  static Program Read(std::string_view program, const ParseOptions& options);
+
+  // Fills in 'structs_' and 'structs_by_name_' from 'struct_types_'.
+  void IndexStructs();
+
+  // Lays out the struct type with the given id, after any struct types it
+  // contains. 'state' holds the progress of each struct type (see
+  // IndexStructs()).
+  void LayOutStruct(int id, vector<char>& state);
+
+  // Resolves the targets of the direct calls and the fields of the gep
+  // instructions of the functions.
+  void ResolveFunctions();
+
   // Struct type name ==> (field name ==> type).
   map<string, map<string, Type>> struct_types_;
 
+  // Id ==> struct type, and the ids indexed by name.
+  vector<StructLayout> structs_;
+  util::SymbolMap<int> structs_by_name_;
+
   // Function name ==> function. The entry point is a function named 'main'.
   map<string, FuncPtr_t> functions_;
 
+  // The same functions, indexed by their interned names.
+  util::SymbolMap<const Function*> functions_by_name_;
+
   // Function name ==> global function pointer variable (e.g., function 'foo'
   // would map to variable '@foo' that is a pointer to 'foo'). Only contains
   // entries for those functions whose address has been taken (i.e., the global
   // function pointer is used somewhere in the code).
   map<string, VarPtr_t> func_ptrs_;
+
+  // The arena that owns the variables, if the program was read with
+  // ParseOptions::use_arena (see Function::arena_).
+  shared_ptr<const util::Arena> arena_;
 };
 
+// A convenient type alias. We use ProgramPtr_t to share one program among many
+// holders (e.g., analyses): sharing is O(1), whereas copying a Program is
+// linear in its number of functions. A Program is never modified once
+// constructed, so it may be read from several threads at once.
+using ProgramPtr_t = shared_ptr<const Program>;
+
 }  // namespace ir
 
 // Allow hashing of Types and Operands for use in unordered_map and
@@ -721,11 +1336,7 @@ struct hash<variant<monostate, string, vector<ir::Type>>> {
 
 template <>
 struct hash<ir::Type> {
-  inline size_t operator()(const ir::Type& type) const {
-    std::size_t val = 0;
-    hash_combine(val, type.indirection(), type.base_type());
-    return val;
-  }
+  inline size_t operator()(const ir::Type& type) const { return type.Hash(); }
 };
 
 template <>
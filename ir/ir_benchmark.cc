@@ -0,0 +1,353 @@
+// Measures reading and writing large generated programs.
+
+#include <benchmark/benchmark.h>
+
+#include "ir/compact_code.h"
+#include "ir/ir.h"
+#include "ir/program_view.h"
+
+namespace {
+
+using namespace ir;
+
+// Returns the text of a program with 'num_functions' functions of roughly
+// 600 bytes each.
+string MakeProgram(int num_functions) {
+  string program = "struct node_t {\n  next: node_t*\n  val: int\n}\n\n";
+  for (int i = 0; i < num_functions; i++) {
+    string f = std::to_string(i);
+    program += "function func" + f + "(a:int*, b:node_t*) -> int {\n";
+    program += "entry:\n";
+    program += "  tmp:int = $load a:int*\n";
+    program += "  sum:int = $arith add tmp:int -1\n";
+    program += "  fld:node_t** = $gep b:node_t* 0 next\n";
+    program += "  res:int = $call func" + std::to_string(i / 2) +
+               "(a:int*, @nullptr:node_t*)\n";
+    program += "  fp:int[int*,node_t*]* = $copy @func" + f +
+               ":int[int*,node_t*]*\n";
+    program += "  cmp:int = $cmp lt res:int 1000\n";
+    program += "  $branch cmp:int body exit\n\n";
+    program += "body:\n";
+    program += "  $store a:int* res:int\n";
+    program += "  $jump entry\n\n";
+    program += "exit:\n";
+    program += "  $ret res:int\n";
+    program += "}\n\n";
+  }
+  program += "function main() -> int {\nentry:\n  $ret 0\n}\n";
+  return program;
+}
+
+// Returns the text of a program with 'num_functions' functions, each a chain of
+// 'length' instructions that assign to a local variable of their own.
+string MakeChainProgram(int num_functions, int length) {
+  string program;
+  for (int i = 0; i < num_functions; i++) {
+    program += "function func" + std::to_string(i) + "(v0:int) -> int {\n";
+    program += "entry:\n";
+    for (int j = 1; j <= length; j++) {
+      program += "  v" + std::to_string(j) + ":int = $arith add v" +
+                 std::to_string(j - 1) + ":int 1\n";
+    }
+    program += "  $ret v" + std::to_string(length) + ":int\n";
+    program += "}\n\n";
+  }
+  program += "function main() -> int {\nentry:\n  $ret 0\n}\n";
+  return program;
+}
+
+void BM_FromString(benchmark::State& state) {
+  string program = MakeProgram(state.range(0));
+  ParseOptions options;
+  options.num_threads = state.range(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Program::FromString(program, options));
+  }
+  state.SetBytesProcessed(state.iterations() * program.size());
+}
+BENCHMARK(BM_FromString)
+    ->ArgsProduct({{1000, 10000}, {1, 2, 4, 8}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Builds and destroys a program of about 200k instructions, in functions of
+// range(0) instructions each, with (range(1) == 1) or without an arena.
+void BM_ConstructProgram(benchmark::State& state) {
+  string program = MakeChainProgram(200000 / state.range(0), state.range(0));
+  ParseOptions options;
+  options.use_arena = state.range(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Program::FromString(program, options));
+  }
+}
+BENCHMARK(BM_ConstructProgram)
+    ->ArgsProduct({{10, 2000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+// Like BM_ConstructProgram, but times only destroying the program.
+void BM_DestroyProgram(benchmark::State& state) {
+  string program = MakeChainProgram(200000 / state.range(0), state.range(0));
+  ParseOptions options;
+  options.use_arena = state.range(1);
+  for (auto _ : state) {
+    state.PauseTiming();
+    optional<Program> parsed = Program::FromString(program, options);
+    state.ResumeTiming();
+    parsed.reset();
+  }
+}
+BENCHMARK(BM_DestroyProgram)
+    ->ArgsProduct({{10, 2000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_DeserializeBinary(benchmark::State& state) {
+  string binary =
+      Program::FromString(MakeProgram(state.range(0))).SerializeBinary();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Program::DeserializeBinary(binary));
+  }
+  state.SetBytesProcessed(state.iterations() * binary.size());
+}
+BENCHMARK(BM_DeserializeBinary)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+// Looks up a single function, as a query touching little of a program would.
+void BM_ProgramViewOneFunction(benchmark::State& state) {
+  string binary =
+      Program::FromString(MakeProgram(state.range(0))).SerializeBinary();
+  for (auto _ : state) {
+    ProgramView view(binary);
+    benchmark::DoNotOptimize(&view["func1"]);
+  }
+}
+BENCHMARK(BM_ProgramViewOneFunction)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_TextProgramViewOneFunction(benchmark::State& state) {
+  string program = MakeProgram(state.range(0));
+  for (auto _ : state) {
+    ProgramView view(program);
+    benchmark::DoNotOptimize(&view["func1"]);
+  }
+}
+BENCHMARK(BM_TextProgramViewOneFunction)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_SerializeBinary(benchmark::State& state) {
+  Program program = Program::FromString(MakeProgram(state.range(0)));
+  for (auto _ : state) benchmark::DoNotOptimize(program.SerializeBinary());
+}
+BENCHMARK(BM_SerializeBinary)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ToString(benchmark::State& state) {
+  Program program = Program::FromString(MakeProgram(state.range(0)));
+  for (auto _ : state) benchmark::DoNotOptimize(program.ToString());
+}
+BENCHMARK(BM_ToString)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Streams the text to a file, as dumping a program would, without building it
+// up as a string.
+void BM_WriteToFile(benchmark::State& state) {
+  Program program = Program::FromString(MakeProgram(state.range(0)));
+  for (auto _ : state) program.WriteToFile("/dev/null");
+}
+BENCHMARK(BM_WriteToFile)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+// Returns the sum of the indirections of the variables used by the
+// instructions of 'program' (of the kinds that MakeProgram() generates),
+// reading them through the instructions' accessors as an analysis would.
+int SumVariableIndirections(const Program& program) {
+  int sum = 0;
+  auto add_var = [&sum](const Variable* var) {
+    sum += var->type().indirection();
+  };
+  auto add_op = [&add_var](const Operand& op) {
+    if (op.IsVariable()) add_var(op.GetVar().get());
+  };
+
+  for (const auto& [name, function] : program.functions()) {
+    for (const Instruction* inst : function->instructions()) {
+      switch (inst->GetOpcode()) {
+        case Instruction::kArith:
+          add_var(inst->AsArith().lhs().get());
+          add_op(inst->AsArith().op1());
+          add_op(inst->AsArith().op2());
+          break;
+        case Instruction::kCmp:
+          add_var(inst->AsCmp().lhs().get());
+          add_op(inst->AsCmp().op1());
+          add_op(inst->AsCmp().op2());
+          break;
+        case Instruction::kCopy:
+          add_var(inst->AsCopy().lhs().get());
+          add_op(inst->AsCopy().rhs());
+          break;
+        case Instruction::kLoad:
+          add_var(inst->AsLoad().lhs().get());
+          add_var(inst->AsLoad().src().get());
+          break;
+        case Instruction::kStore:
+          add_var(inst->AsStore().dst().get());
+          add_op(inst->AsStore().value());
+          break;
+        case Instruction::kGep:
+          add_var(inst->AsGep().lhs().get());
+          add_var(inst->AsGep().src_ptr().get());
+          add_op(inst->AsGep().index());
+          break;
+        case Instruction::kCall:
+          add_var(inst->AsCall().lhs().get());
+          for (const Operand& arg : inst->AsCall().args()) add_op(arg);
+          break;
+        case Instruction::kRet:
+          add_op(inst->AsRet().retval());
+          break;
+        case Instruction::kBranch:
+          add_op(inst->AsBranch().condition());
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return sum;
+}
+
+// Traverses one program shared by all the threads, as analyses running in
+// parallel over a loaded program would. Reading the program doesn't write to
+// it (e.g., to reference counts), so the time per traversal should stay about
+// the same as threads are added (up to the number of cores).
+void BM_TraverseSharedProgram(benchmark::State& state) {
+  static const Program program = Program::FromString(MakeProgram(1000));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SumVariableIndirections(program));
+  }
+}
+BENCHMARK(BM_TraverseSharedProgram)
+    ->ThreadRange(1, 8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Counts the uses (and definitions) of each local variable of each function of
+// 'program' in a vector indexed by local id, as a dataflow analysis keeping
+// per-variable state would; returns the total. The ids are looked up through
+// Function::LocalId().
+int CountLocalUses(const Program& program) {
+  int total = 0;
+  vector<int> counts;
+  for (const auto& [name, function] : program.functions()) {
+    counts.assign(function->locals().size(), 0);
+    auto add_var = [&](const VarPtr_t& var) {
+      int id = function->LocalId(var.get());
+      if (id >= 0) counts[id]++;
+    };
+    auto add_op = [&](const Operand& op) {
+      if (op.IsVariable()) add_var(op.GetVar());
+    };
+    for (const Instruction* inst : function->instructions()) {
+      switch (inst->GetOpcode()) {
+        case Instruction::kArith:
+          add_var(inst->AsArith().lhs());
+          add_op(inst->AsArith().op1());
+          add_op(inst->AsArith().op2());
+          break;
+        case Instruction::kCmp:
+          add_var(inst->AsCmp().lhs());
+          add_op(inst->AsCmp().op1());
+          add_op(inst->AsCmp().op2());
+          break;
+        case Instruction::kCopy:
+          add_var(inst->AsCopy().lhs());
+          add_op(inst->AsCopy().rhs());
+          break;
+        case Instruction::kLoad:
+          add_var(inst->AsLoad().lhs());
+          add_var(inst->AsLoad().src());
+          break;
+        case Instruction::kStore:
+          add_var(inst->AsStore().dst());
+          add_op(inst->AsStore().value());
+          break;
+        case Instruction::kGep:
+          add_var(inst->AsGep().lhs());
+          add_var(inst->AsGep().src_ptr());
+          add_op(inst->AsGep().index());
+          break;
+        case Instruction::kCall:
+          add_var(inst->AsCall().lhs());
+          for (const Operand& arg : inst->AsCall().args()) add_op(arg);
+          break;
+        case Instruction::kRet:
+          add_op(inst->AsRet().retval());
+          break;
+        case Instruction::kBranch:
+          add_op(inst->AsBranch().condition());
+          break;
+        default:
+          break;
+      }
+    }
+    for (int count : counts) total += count;
+  }
+  return total;
+}
+
+// Like CountLocalUses(), but reads the local ids straight out of the slots of
+// the compact encoding of each function.
+int CountLocalUsesCompact(const Program& program) {
+  int total = 0;
+  vector<int> counts;
+  for (const auto& [name, function] : program.functions()) {
+    const CompactCode& code = function->compact_code();
+    counts.assign(code.num_locals(), 0);
+    auto add = [&](CompactCode::Kind kind, int32_t value) {
+      if (kind == CompactCode::kVar && value < code.num_locals()) {
+        counts[value]++;
+      }
+    };
+    for (const CompactCode::Record& record : code.records()) {
+      for (int i = 0; i < CompactCode::kNumSlots; ++i) {
+        add(record.kind(i), record.slots[i]);
+      }
+    }
+    for (const CompactCode::ListEntry& entry : code.lists()) {
+      add(entry.kind, entry.value);
+    }
+    for (int count : counts) total += count;
+  }
+  return total;
+}
+
+// Compares counting local variable uses through the instructions with doing
+// so through their compact encoding (built up front, as it would be cached
+// for an analysis).
+void BM_CountLocalUses(benchmark::State& state) {
+  static const Program program = Program::FromString(MakeProgram(1000));
+  bool compact = state.range(0);
+  CHECK_EQ(CountLocalUsesCompact(program), CountLocalUses(program));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compact ? CountLocalUsesCompact(program)
+                                     : CountLocalUses(program));
+  }
+}
+BENCHMARK(BM_CountLocalUses)
+    ->ArgName("compact")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
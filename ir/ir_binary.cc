@@ -0,0 +1,602 @@
+// Program::SerializeBinary() and Program::DeserializeBinary(); see ir_binary.h
+// for the format.
+
+#include "ir/ir_binary.h"
+
+namespace ir {
+
+namespace {  // Helpers for Program::SerializeBinary().
+
+// Maps integers of small magnitude (positive or negative) to small unsigned
+// integers, so that they have short varint encodings.
+uint64_t ZigZag(int value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+int UnZigZag(uint64_t value) {
+  uint32_t bits = static_cast<uint32_t>(value);
+  return static_cast<int>((bits >> 1) ^ -(bits & 1));
+}
+
+// Builds the tables while the function bodies are being encoded, and then
+// assembles the whole image.
+class Serializer {
+ public:
+  string Serialize(const Program& program) {
+    for (const auto& [name, fields] : program.struct_types()) {
+      structs_.WriteVarint(String(util::Symbol(name)));
+      structs_.WriteVarint(fields.size());
+      for (const auto& [field, type] : fields) {
+        structs_.WriteVarint(String(util::Symbol(field)));
+        structs_.WriteVarint(TypeIndex(type));
+      }
+    }
+
+    BinaryWriter directory, bodies;
+    for (const auto& [name, function] : program.functions()) {
+      size_t offset = bodies.data().size();
+      bodies.WriteBytes(SerializeFunction(*function));
+      directory.WriteVarint(String(function->name_symbol()));
+      directory.WriteVarint(TypeIndex(FunctionType(*function)));
+      directory.WriteVarint(offset);
+      directory.WriteVarint(bodies.data().size() - offset);
+    }
+
+    BinaryWriter image;
+    image.WriteBytes(kBinaryMagic);
+    image.WriteVarint(kBinaryVersion);
+
+    image.WriteVarint(strings_.size());
+    for (util::Symbol str : strings_) {
+      image.WriteVarint(str.str().size());
+      image.WriteBytes(str.str());
+    }
+
+    image.WriteVarint(num_types_);
+    image.WriteBytes(types_.data());
+
+    image.WriteVarint(program.struct_types().size());
+    image.WriteBytes(structs_.data());
+
+    image.WriteVarint(global_index_.size());
+    image.WriteBytes(globals_.data());
+
+    image.WriteVarint(program.functions().size());
+    image.WriteBytes(directory.data());
+    image.WriteBytes(bodies.data());
+
+    return image.data();
+  }
+
+ private:
+  // Returns the index of 'str' in the string table, adding it if necessary.
+  uint64_t String(util::Symbol str) {
+    auto [it, inserted] = string_index_.emplace(str, strings_.size());
+    if (inserted) strings_.push_back(str);
+    return it->second;
+  }
+
+  // Returns the index of 'type' in the type table, adding it (after any types
+  // it refers to) if necessary.
+  uint64_t TypeIndex(const Type& type) {
+    if (auto it = type_index_.find(type); it != type_index_.end()) {
+      return it->second;
+    }
+
+    vector<uint64_t> func_types;
+    uint64_t name = 0;
+    if (type.BaseKind() == Type::kFunc) {
+      for (const auto& t : type.GetFuncTypes()) {
+        func_types.push_back(TypeIndex(t));
+      }
+    } else if (type.BaseKind() == Type::kStruct) {
+      name = String(util::Symbol(type.GetStructName()));
+    }
+
+    types_.WriteVarint(type.indirection());
+    types_.WriteVarint(type.BaseKind());
+    if (type.BaseKind() == Type::kStruct) {
+      types_.WriteVarint(name);
+    } else if (type.BaseKind() == Type::kFunc) {
+      types_.WriteVarint(func_types.size());
+      for (uint64_t t : func_types) types_.WriteVarint(t);
+    }
+
+    type_index_[type] = num_types_;
+    return num_types_++;
+  }
+
+  // Returns the variable ref for 'var', adding it to the globals if
+  // necessary.
+  uint64_t VarRef(const VarPtr_t& var) {
+    if (var->name()[0] == '@') {
+      auto [it, inserted] =
+          global_index_.emplace(var.get(), global_index_.size());
+      if (inserted) {
+        globals_.WriteVarint(String(var->name_symbol()));
+        globals_.WriteVarint(TypeIndex(var->type()));
+      }
+      return (it->second << 1) | 1;
+    }
+
+    return static_cast<uint64_t>(function_->LocalId(var.get())) << 1;
+  }
+
+  uint64_t OperandRef(const Operand& op) {
+    if (op.IsConstInt()) return (ZigZag(op.GetInt()) << 1) | 1;
+    return VarRef(op.GetVar()) << 1;
+  }
+
+  void WriteOperands(BinaryWriter& out, const vector<Operand>& ops) {
+    out.WriteVarint(ops.size());
+    for (const auto& op : ops) out.WriteVarint(OperandRef(op));
+  }
+
+  void WriteInstruction(BinaryWriter& out, const Instruction& inst) {
+    out.WriteVarint(inst.GetOpcode());
+
+    switch (inst.GetOpcode()) {
+      case Instruction::kArith: {
+        const auto& i = inst.AsArith();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(OperandRef(i.op1()));
+        out.WriteVarint(OperandRef(i.op2()));
+        out.WriteVarint(i.operation());
+        break;
+      }
+
+      case Instruction::kCmp: {
+        const auto& i = inst.AsCmp();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(OperandRef(i.op1()));
+        out.WriteVarint(OperandRef(i.op2()));
+        out.WriteVarint(i.operation());
+        break;
+      }
+
+      case Instruction::kPhi: {
+        const auto& i = inst.AsPhi();
+        out.WriteVarint(VarRef(i.lhs()));
+        WriteOperands(out, i.ops());
+        break;
+      }
+
+      case Instruction::kCopy: {
+        const auto& i = inst.AsCopy();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(OperandRef(i.rhs()));
+        break;
+      }
+
+      case Instruction::kAlloc:
+        out.WriteVarint(VarRef(inst.AsAlloc().lhs()));
+        break;
+
+      case Instruction::kAddrof: {
+        const auto& i = inst.AsAddrOf();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(VarRef(i.rhs()));
+        break;
+      }
+
+      case Instruction::kLoad: {
+        const auto& i = inst.AsLoad();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(VarRef(i.src()));
+        break;
+      }
+
+      case Instruction::kStore: {
+        const auto& i = inst.AsStore();
+        out.WriteVarint(VarRef(i.dst()));
+        out.WriteVarint(OperandRef(i.value()));
+        break;
+      }
+
+      case Instruction::kGep: {
+        const auto& i = inst.AsGep();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(VarRef(i.src_ptr()));
+        out.WriteVarint(OperandRef(i.index()));
+        out.WriteVarint(String(i.field_name_symbol()));
+        break;
+      }
+
+      case Instruction::kSelect: {
+        const auto& i = inst.AsSelect();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(OperandRef(i.condition()));
+        out.WriteVarint(OperandRef(i.true_op()));
+        out.WriteVarint(OperandRef(i.false_op()));
+        break;
+      }
+
+      case Instruction::kCall: {
+        const auto& i = inst.AsCall();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(String(i.callee_symbol()));
+        WriteOperands(out, i.args());
+        break;
+      }
+
+      case Instruction::kICall: {
+        const auto& i = inst.AsICall();
+        out.WriteVarint(VarRef(i.lhs()));
+        out.WriteVarint(VarRef(i.func_ptr()));
+        WriteOperands(out, i.args());
+        break;
+      }
+
+      case Instruction::kRet:
+        out.WriteVarint(OperandRef(inst.AsRet().retval()));
+        break;
+
+      case Instruction::kJump:
+        out.WriteVarint(String(inst.AsJump().label_symbol()));
+        break;
+
+      case Instruction::kBranch: {
+        const auto& i = inst.AsBranch();
+        out.WriteVarint(OperandRef(i.condition()));
+        out.WriteVarint(String(i.label_true_symbol()));
+        out.WriteVarint(String(i.label_false_symbol()));
+        break;
+      }
+
+      default:
+        LOG(FATAL) << "Unknown opcode";
+    }
+  }
+
+  string SerializeFunction(const Function& function) {
+    function_ = &function;
+
+    // The parameters are the first locals.
+    for (size_t i = 0; i < function.parameters().size(); ++i) {
+      const auto& param = function.parameters()[i];
+      CHECK_EQ(function.LocalId(param.get()), static_cast<int>(i))
+          << "Duplicate parameter: " << param->name();
+    }
+
+    BinaryWriter blocks;
+    blocks.WriteVarint(function.layout().size());
+    for (const auto& bb : function.layout()) {
+      blocks.WriteVarint(String(bb.label_symbol()));
+      blocks.WriteVarint(bb.body().size());
+      for (const auto& inst : bb.body()) WriteInstruction(blocks, inst);
+    }
+
+    BinaryWriter body;
+    body.WriteVarint(TypeIndex(function.return_type()));
+    body.WriteVarint(function.locals().size());
+    for (const auto& local : function.locals()) {
+      body.WriteVarint(String(local->name_symbol()));
+      body.WriteVarint(TypeIndex(local->type()));
+    }
+    body.WriteVarint(function.parameters().size());
+    body.WriteBytes(blocks.data());
+    return body.data();
+  }
+
+  // The string table.
+  unordered_map<util::Symbol, uint64_t> string_index_;
+  vector<util::Symbol> strings_;
+
+  // The encoded type table.
+  unordered_map<Type, uint64_t> type_index_;
+  BinaryWriter types_;
+  uint64_t num_types_ = 0;
+
+  // The encoded struct and global tables.
+  BinaryWriter structs_;
+  unordered_map<const Variable*, uint64_t> global_index_;
+  BinaryWriter globals_;
+
+  // The function currently being encoded, whose locals are referred to by
+  // their ids.
+  const Function* function_ = nullptr;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+BinaryImage::BinaryImage(std::string_view data) {
+  BinaryReader reader(data);
+  CHECK(reader.ReadBytes(kBinaryMagic.size()) == kBinaryMagic)
+      << "Not a binary IR image";
+  uint64_t version = reader.ReadVarint();
+  CHECK_EQ(version, kBinaryVersion) << "Unsupported binary IR version";
+
+  // The size of each table is checked against the remaining input (every
+  // entry takes at least one byte) so that a corrupt count can't make us
+  // allocate huge amounts of memory.
+  const auto read_count = [&]() { return reader.ReadIndex(data.size() + 1); };
+
+  strings_.resize(read_count());
+  for (auto& str : strings_) {
+    str = util::Symbol(reader.ReadBytes(reader.ReadVarint()));
+  }
+
+  const auto read_string = [&]() {
+    return strings_[reader.ReadIndex(strings_.size())].str();
+  };
+
+  size_t num_types = read_count();
+  types_.reserve(num_types);
+  for (size_t i = 0; i < num_types; i++) {
+    uint64_t indirection = reader.ReadVarint();
+    Type type;
+    switch (reader.ReadVarint()) {
+      case Type::kInt:
+        break;
+
+      case Type::kStruct:
+        type = Type::Struct(read_string());
+        break;
+
+      case Type::kFunc: {
+        vector<Type> func_types(reader.ReadIndex(types_.size() + 2));
+        CHECK(!func_types.empty()) << "Malformed binary IR: bad function type";
+        for (auto& t : func_types) t = types_[reader.ReadIndex(types_.size())];
+        type = Type::Function(func_types);
+        break;
+      }
+
+      default:
+        LOG(FATAL) << "Malformed binary IR: bad base type";
+    }
+    for (uint64_t j = 0; j < indirection; j++) type = type.PtrTo();
+    types_.push_back(type);
+  }
+
+  const auto read_type = [&]() {
+    return types_[reader.ReadIndex(types_.size())];
+  };
+
+  size_t num_structs = read_count();
+  for (size_t i = 0; i < num_structs; i++) {
+    string name = read_string();
+    auto& fields = struct_types_[name];
+    size_t num_fields = read_count();
+    for (size_t j = 0; j < num_fields; j++) {
+      string field = read_string();
+      fields[field] = read_type();
+    }
+  }
+
+  globals_.resize(read_count());
+  for (auto& global : globals_) {
+    string name = read_string();
+    global = make_shared<const Variable>(name, read_type());
+  }
+
+  // Function body offsets are relative to the end of the directory, so read
+  // them all before checking them.
+  vector<pair<uint64_t, uint64_t>> ranges(read_count());
+  function_names_.resize(ranges.size());
+  function_symbols_.resize(ranges.size());
+  function_types_.resize(ranges.size());
+  for (size_t i = 0; i < ranges.size(); i++) {
+    function_symbols_[i] = strings_[reader.ReadIndex(strings_.size())];
+    function_names_[i] = function_symbols_[i].str();
+    function_types_[i] = read_type();
+    CHECK_EQ(function_types_[i].BaseKind(), Type::kFunc)
+        << "Malformed binary IR: bad function type";
+    ranges[i].first = reader.ReadVarint();
+    ranges[i].second = reader.ReadVarint();
+  }
+
+  std::string_view bodies = reader.Rest();
+  for (const auto& [offset, size] : ranges) {
+    CHECK(offset <= bodies.size() && size <= bodies.size() - offset)
+        << "Malformed binary IR: function body out of range";
+    function_bodies_.push_back(bodies.substr(offset, size));
+  }
+}
+
+VarPtr_t BinaryImage::ReadVar(BinaryReader& reader,
+                              const vector<VarPtr_t>& locals) const {
+  uint64_t ref = reader.ReadVarint();
+  const auto& vars = (ref & 1) ? globals_ : locals;
+  CHECK_LT(ref >> 1, vars.size()) << "Malformed binary IR: bad variable";
+  return vars[ref >> 1];
+}
+
+Operand BinaryImage::ReadOperand(BinaryReader& reader,
+                                 const vector<VarPtr_t>& locals) const {
+  uint64_t ref = reader.ReadVarint();
+  if (ref & 1) return Operand(UnZigZag(ref >> 1));
+
+  ref >>= 1;
+  const auto& vars = (ref & 1) ? globals_ : locals;
+  CHECK_LT(ref >> 1, vars.size()) << "Malformed binary IR: bad variable";
+  return Operand(vars[ref >> 1]);
+}
+
+Function BinaryImage::ReadFunction(int index) const {
+  CHECK(index >= 0 && static_cast<size_t>(index) < function_bodies_.size())
+      << "function index out of bounds";
+  std::string_view data = function_bodies_[index];
+  BinaryReader reader(data);
+
+  const auto read_symbol = [&]() {
+    return strings_[reader.ReadIndex(strings_.size())];
+  };
+  const auto read_var = [&](const vector<VarPtr_t>& locals) {
+    return ReadVar(reader, locals);
+  };
+  const auto read_op = [&](const vector<VarPtr_t>& locals) {
+    return ReadOperand(reader, locals);
+  };
+
+  Type return_type = types_[reader.ReadIndex(types_.size())];
+
+  vector<VarPtr_t> locals(reader.ReadIndex(data.size() + 1));
+  for (auto& local : locals) {
+    util::Symbol name = read_symbol();
+    Type type = types_[reader.ReadIndex(types_.size())];
+    local = make_shared<const Variable>(name, type);
+  }
+
+  vector<VarPtr_t> params(locals.begin(),
+                          locals.begin() + reader.ReadIndex(locals.size() + 1));
+
+  vector<BasicBlock> blocks;
+  size_t num_blocks = reader.ReadIndex(data.size() + 1);
+  blocks.reserve(num_blocks);
+  for (size_t b = 0; b < num_blocks; b++) {
+    util::Symbol label = read_symbol();
+    vector<Instruction> insts;
+    size_t num_insts = reader.ReadIndex(data.size() + 1);
+    insts.reserve(num_insts);
+
+    // As when reading text, the fields must be read in order so they are read
+    // into local variables first.
+    const auto read_ops = [&]() {
+      vector<Operand> ops;
+      size_t num_ops = reader.ReadIndex(data.size() + 1);
+      ops.reserve(num_ops);
+      for (size_t i = 0; i < num_ops; i++) ops.push_back(read_op(locals));
+      return ops;
+    };
+
+    for (size_t i = 0; i < num_insts; i++) {
+      switch (reader.ReadVarint()) {
+        case Instruction::kArith: {
+          auto lhs = read_var(locals);
+          auto op1 = read_op(locals);
+          auto op2 = read_op(locals);
+          auto aop = reader.ReadIndex(ArithInst::kDivide + 1);
+          insts.push_back(
+              ArithInst(lhs, op1, op2, static_cast<ArithInst::Aop>(aop)));
+          break;
+        }
+
+        case Instruction::kCmp: {
+          auto lhs = read_var(locals);
+          auto op1 = read_op(locals);
+          auto op2 = read_op(locals);
+          auto rop = reader.ReadIndex(CmpInst::kGreaterThanEqual + 1);
+          insts.push_back(
+              CmpInst(lhs, op1, op2, static_cast<CmpInst::Rop>(rop)));
+          break;
+        }
+
+        case Instruction::kPhi: {
+          auto lhs = read_var(locals);
+          insts.push_back(PhiInst(lhs, read_ops()));
+          break;
+        }
+
+        case Instruction::kCopy: {
+          auto lhs = read_var(locals);
+          insts.push_back(CopyInst(lhs, read_op(locals)));
+          break;
+        }
+
+        case Instruction::kAlloc:
+          insts.push_back(AllocInst(read_var(locals)));
+          break;
+
+        case Instruction::kAddrof: {
+          auto lhs = read_var(locals);
+          insts.push_back(AddrOfInst(lhs, read_var(locals)));
+          break;
+        }
+
+        case Instruction::kLoad: {
+          auto lhs = read_var(locals);
+          insts.push_back(LoadInst(lhs, read_var(locals)));
+          break;
+        }
+
+        case Instruction::kStore: {
+          auto dst = read_var(locals);
+          insts.push_back(StoreInst(dst, read_op(locals)));
+          break;
+        }
+
+        case Instruction::kGep: {
+          auto lhs = read_var(locals);
+          auto src_ptr = read_var(locals);
+          auto idx = read_op(locals);
+          insts.push_back(GepInst(lhs, src_ptr, idx, read_symbol()));
+          break;
+        }
+
+        case Instruction::kSelect: {
+          auto lhs = read_var(locals);
+          auto condition = read_op(locals);
+          auto true_op = read_op(locals);
+          auto false_op = read_op(locals);
+          insts.push_back(SelectInst(lhs, condition, true_op, false_op));
+          break;
+        }
+
+        case Instruction::kCall: {
+          auto lhs = read_var(locals);
+          auto callee = read_symbol();
+          insts.push_back(CallInst(lhs, callee, read_ops()));
+          break;
+        }
+
+        case Instruction::kICall: {
+          auto lhs = read_var(locals);
+          auto func_ptr = read_var(locals);
+          insts.push_back(ICallInst(lhs, func_ptr, read_ops()));
+          break;
+        }
+
+        case Instruction::kRet:
+          insts.push_back(RetInst(read_op(locals)));
+          break;
+
+        case Instruction::kJump:
+          insts.push_back(JumpInst(read_symbol()));
+          break;
+
+        case Instruction::kBranch: {
+          auto condition = read_op(locals);
+          auto label_true = read_symbol();
+          auto label_false = read_symbol();
+          insts.push_back(BranchInst(condition, label_true, label_false));
+          break;
+        }
+
+        default:
+          LOG(FATAL) << "Malformed binary IR: unknown opcode";
+      }
+    }
+
+    blocks.emplace_back(label, std::move(insts));
+  }
+
+  CHECK(reader.AtEnd()) << "Malformed binary IR: trailing bytes in function";
+  Function function(function_symbols_[index], return_type, params,
+                    std::move(blocks));
+  CHECK_EQ(FunctionType(function), function_types_[index])
+      << "Malformed binary IR: function type doesn't match directory";
+  return function;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+string Program::SerializeBinary() const {
+  return Serializer().Serialize(*this);
+}
+
+Program Program::DeserializeBinary(std::string_view data) {
+  BinaryImage image(data);
+
+  vector<Function> functions;
+  functions.reserve(image.function_names().size());
+  for (size_t i = 0; i < image.function_names().size(); i++) {
+    functions.push_back(image.ReadFunction(i));
+  }
+
+  return Program(image.struct_types(), std::move(functions));
+}
+
+}  // namespace ir
@@ -0,0 +1,154 @@
+#pragma once
+
+// The binary IR format written by Program::SerializeBinary(). Every integer is
+// an unsigned LEB128 varint, and every string, type, or global variable is
+// stored once in a table and referred to by its index. The layout is:
+//
+//   header:    the magic bytes "IRB", then the format version.
+//   strings:   count, then (length, bytes) per string.
+//   types:     count, then per type: indirection, base kind (Type::Base), and
+//              then nothing (int), the name (struct), or the number of types
+//              followed by the return and parameter types (function). A type
+//              only refers to types before it in the table.
+//   structs:   count, then per struct type: name, number of fields, and
+//              (name, type) per field.
+//   globals:   count, then (name, type) per global variable (global function
+//              pointers and null pointers).
+//   functions: count, then per function: name, type (see FunctionType()), and
+//              the offset and size of its body within the bodies section.
+//   bodies:    the bytes of each function body.
+//
+// A function body is: return type, number of local variables, (name, type)
+// per local, number of parameters (which are the first locals, in order),
+// number of basic blocks, and then per block: label, number of instructions,
+// and the instructions. An instruction is its opcode followed by its fields in
+// the order of its constructor's parameters: variables are variable refs,
+// operands are operand refs, labels/callees/field names are strings, lists are
+// prefixed by their length, and operations are integers.
+//
+// A variable ref is (index << 1) | 1 for a global variable and (index << 1)
+// for a local variable. An operand ref is (zigzag(value) << 1) | 1 for an
+// integer constant and (variable ref << 1) for a variable.
+
+#include <string_view>
+
+#include "ir/ir.h"
+#include "ir/program_image.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// Identifies a binary IR image; followed by kBinaryVersion.
+inline constexpr std::string_view kBinaryMagic = "IRB";
+
+// The current version of the format; images with any other version are
+// rejected. Version 2 added function types to the function directory, so that
+// calls can be checked without decoding the callee.
+inline constexpr uint64_t kBinaryVersion = 2;
+
+// Appends the pieces of the format to a buffer.
+class BinaryWriter {
+ public:
+  void WriteVarint(uint64_t value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  void WriteBytes(std::string_view bytes) { data_.append(bytes); }
+
+  const string& data() const { return data_; }
+
+ private:
+  string data_;
+};
+
+// Reads the pieces of the format from a buffer (which is not copied); FATALs
+// on reading past the end.
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::string_view data) : data_(data) {}
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      CHECK_LT(pos_, data_.size()) << "Malformed binary IR: truncated";
+      uint8_t byte = data_[pos_++];
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    LOG(FATAL) << "Malformed binary IR: varint too long";
+  }
+
+  std::string_view ReadBytes(size_t count) {
+    CHECK_LE(count, data_.size() - pos_) << "Malformed binary IR: truncated";
+    std::string_view bytes = data_.substr(pos_, count);
+    pos_ += count;
+    return bytes;
+  }
+
+  // Returns an index read from the input, checking that it is less than
+  // 'size'.
+  size_t ReadIndex(size_t size) {
+    uint64_t index = ReadVarint();
+    CHECK_LT(index, size) << "Malformed binary IR: index out of range";
+    return index;
+  }
+
+  // Returns the rest of the input without consuming it.
+  std::string_view Rest() const { return data_.substr(pos_); }
+
+  bool AtEnd() const { return pos_ == data_.size(); }
+
+ private:
+  std::string_view data_;
+  size_t pos_ = 0;
+};
+
+// A binary IR image whose tables (strings, types, struct types, globals, and
+// the function directory) are decoded up front but whose functions are only
+// decoded on request. The image is not copied, so it must outlive this object.
+// FATALs if the image is malformed.
+class BinaryImage : public ProgramImage {
+ public:
+  explicit BinaryImage(std::string_view data);
+
+  const map<string, map<string, Type>>& struct_types() const override {
+    return struct_types_;
+  }
+
+  const vector<string>& function_names() const override {
+    return function_names_;
+  }
+
+  const vector<Type>& function_types() const override {
+    return function_types_;
+  }
+
+  const vector<VarPtr_t>& globals() const override { return globals_; }
+
+  Function ReadFunction(int index) const override;
+
+ private:
+  // Reads a variable ref or an operand ref given the function's locals.
+  VarPtr_t ReadVar(BinaryReader& reader, const vector<VarPtr_t>& locals) const;
+  Operand ReadOperand(BinaryReader& reader,
+                      const vector<VarPtr_t>& locals) const;
+
+  // The tables; the strings are interned up front since they are shared by
+  // all the functions.
+  vector<util::Symbol> strings_;
+  vector<Type> types_;
+  map<string, map<string, Type>> struct_types_;
+  vector<VarPtr_t> globals_;
+
+  // The name, type, and body of each function.
+  vector<string> function_names_;
+  vector<util::Symbol> function_symbols_;
+  vector<Type> function_types_;
+  vector<std::string_view> function_bodies_;
+};
+
+}  // namespace ir
@@ -3,6 +3,10 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
 
 #include "ir/ir_tostring_visitor.h"
 #include "ir/irvisitor.h"
@@ -143,6 +147,37 @@ TEST_F(IrTest, InstructionGetters) {
   EXPECT_EQ(branch.AsBranch().label_true(), "foo");
 }
 
+TEST_F(IrTest, OperandTest) {
+  for (int value : {0, 1, -1, 42, std::numeric_limits<int>::min(),
+                    std::numeric_limits<int>::max()}) {
+    Operand op(value);
+    EXPECT_TRUE(op.IsConstInt());
+    EXPECT_FALSE(op.IsVariable());
+    EXPECT_EQ(op.GetInt(), value);
+    EXPECT_EQ(op.GetType(), Type::Int());
+    EXPECT_EQ(op, Operand(value));
+  }
+
+  Operand var(var_);
+  EXPECT_TRUE(var.IsVariable());
+  EXPECT_EQ(var.GetVar(), var_);
+  EXPECT_EQ(var, Operand(var_));
+  EXPECT_FALSE(var == Operand(42));
+  EXPECT_FALSE(var == Operand(make_shared<Variable>("foo", Type::Int())));
+
+  auto name = [](const VarPtr_t& var) { return var->name(); };
+  auto number = [](int value) { return std::to_string(value); };
+  EXPECT_EQ(var.Map(name, number), var_->name());
+  EXPECT_EQ(Operand(42).Map(name, number), "42");
+  EXPECT_EQ(Operand(42).Map([](const VarPtr_t&) { return 0.5; },
+                            [](int value) { return value; }),
+            42.0);
+
+  // An operand is no bigger than a VarPtr_t, which keeps instructions small.
+  EXPECT_EQ(sizeof(Operand), sizeof(VarPtr_t));
+  EXPECT_LE(sizeof(Instruction), 80);
+}
+
 TEST_F(IrTest, VisitorTest) {
   class TestVisitor : public IrVisitor {
    public:
@@ -270,6 +305,41 @@ foo:
 )""");
 }
 
+// A visitor that's reused must start afresh each time.
+TEST_F(IrTest, ToStringVisitorReuseTest) {
+  ToStringVisitor visitor;
+  Instruction(ret_inst_).Visit(&visitor);
+  EXPECT_EQ(visitor.GetString(), "$ret 42\n");
+  Instruction(jump_inst_).Visit(&visitor);
+  EXPECT_EQ(visitor.GetString(), "$jump foo\n");
+}
+
+TEST_F(IrTest, WriteToTest) {
+  string tmpfile =
+      std::filesystem::temp_directory_path() / "ir_test.WriteToTest.ir";
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+      Program program = Program::FromString(ir);
+
+      std::ostringstream out;
+      program.WriteTo(out);
+      EXPECT_EQ(out.str(), ir) << "FILE: " << filename;
+
+      program.WriteToFile(tmpfile);
+      std::ifstream written_in(tmpfile);
+      EXPECT_EQ(string(std::istreambuf_iterator<char>{written_in}, {}), ir)
+          << "FILE: " << filename;
+    }
+  }
+  std::filesystem::remove(tmpfile);
+}
+
 TEST_F(IrTest, FromStringTest) {
   // Iterate over all files in //testdata. For any file "<name>.ir", use
   // FromString() then ToString() and compare against the original.
@@ -286,6 +356,277 @@ TEST_F(IrTest, FromStringTest) {
   }
 }
 
+TEST_F(IrTest, FromFileTest) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+      EXPECT_EQ(Program::FromFile(filename).ToString(), ir)
+          << "FILE: " << filename;
+    }
+  }
+}
+
+TEST_F(IrTest, FromStreamTest) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+
+      // Make sure that items spanning chunk boundaries are handled.
+      for (size_t chunk_size : {1, 7, 1 << 16}) {
+        std::istringstream in(ir);
+        EXPECT_EQ(Program::FromStream(in, chunk_size).ToString(), ir)
+            << "FILE: " << filename << " CHUNK SIZE: " << chunk_size;
+      }
+    }
+  }
+}
+
+TEST_F(IrTest, FromStringParallelTest) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+      for (int num_threads : {0, 2, 8}) {
+        EXPECT_EQ(Program::FromString(ir, {num_threads}).ToString(), ir)
+            << "FILE: " << filename << " THREADS: " << num_threads;
+      }
+    }
+  }
+}
+
+TEST_F(IrTest, FromStringArenaTest) {
+  ParseOptions options;
+  options.use_arena = true;
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+      for (int num_threads : {1, 4}) {
+        options.num_threads = num_threads;
+        EXPECT_EQ(Program::FromString(ir, options).ToString(), ir)
+            << "FILE: " << filename << " THREADS: " << num_threads;
+      }
+    }
+  }
+
+  // The arena owns the variables, local and global, rather than their
+  // VarPtr_ts, and a copy of a function keeps it alive after the program is
+  // gone.
+  optional<Function> main;
+  {
+    Program program = Program::FromString(R"""(function main(x:int) -> int {
+entry:
+  y:int = $copy x:int
+  p:int[int]* = $copy @main:int[int]*
+  $ret y:int
+}
+)""",
+                                          options);
+    const BasicBlock& entry = program["main"]["entry"];
+    EXPECT_EQ(entry[0].AsCopy().lhs().use_count(), 0);
+    EXPECT_EQ(entry[1].AsCopy().rhs().GetVar().use_count(), 0);
+    main = program["main"];
+  }
+  const BasicBlock& entry = (*main)["entry"];
+  EXPECT_EQ(entry[0].AsCopy().lhs()->ToString(), "y:int");
+  EXPECT_EQ(entry[1].AsCopy().rhs().GetVar()->ToString(), "@main:int[int]*");
+}
+
+// Global variables must be shared by all functions even when the functions are
+// parsed on different threads.
+TEST_F(IrTest, FromStringParallelGlobalsTest) {
+  string ir;
+  for (int i = 0; i < 100; i++) {
+    ir += "function f" + std::to_string(i) + "() -> int {\n";
+    ir += "entry:\n";
+    ir += "  fp:int[]* = $copy @main:int[]*\n";
+    ir += "  np:int* = $copy @nullptr:int*\n";
+    ir += "  $ret 0\n";
+    ir += "}\n\n";
+  }
+  ir += "function main() -> int {\nentry:\n  $ret 0\n}\n";
+
+  Program program = Program::FromString(ir, {4});
+  EXPECT_EQ(program.ToString(), Program::FromString(ir).ToString());
+
+  const auto& entry = program["f0"]["entry"];
+  VarPtr_t func_ptr = entry[0].AsCopy().rhs().GetVar();
+  VarPtr_t null_ptr = entry[1].AsCopy().rhs().GetVar();
+  for (const auto& [name, function] : program.functions()) {
+    if (name == "main") continue;
+    const auto& block = (*function)["entry"];
+    EXPECT_EQ(block[0].AsCopy().rhs().GetVar(), func_ptr) << name;
+    EXPECT_EQ(block[1].AsCopy().rhs().GetVar(), null_ptr) << name;
+  }
+}
+
+TEST_F(IrTest, ParseTest) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      std::ifstream ir_in(filename);
+      ASSERT_TRUE(ir_in) << filename;
+
+      string ir(std::istreambuf_iterator<char>{ir_in}, {});
+      vector<string> errors{"stale"};
+      auto program = Program::Parse(ir, &errors);
+      ASSERT_TRUE(program.has_value()) << "FILE: " << filename;
+      EXPECT_EQ(program->ToString(), ir) << "FILE: " << filename;
+      EXPECT_TRUE(errors.empty()) << "FILE: " << filename;
+    }
+  }
+}
+
+// Each malformed item is reported, and the items after it are still read.
+TEST_F(IrTest, ParseSyntaxErrorsTest) {
+  string ir = R"""(struct foo {
+  x: int
+  x: int
+}
+
+function foo() -> int {
+entry:
+  x:int = $arith pow 1 2
+  $ret x:int
+}
+
+function bar() -> int {
+entry:
+  $ret 0
+}
+
+function main() -> int {
+entry:
+  $jump
+}
+)""";
+
+  for (int num_threads : {1, 4}) {
+    vector<string> errors;
+    EXPECT_FALSE(Program::Parse(ir, &errors, {num_threads}).has_value());
+    EXPECT_EQ(errors,
+              vector<string>({
+                  "Syntax error on line 3: Two fields of same struct with "
+                  "same name: x",
+                  "Syntax error on line 8: unknown arithmetic operation: pow",
+                  "Syntax error on line 20: read delimiter or reserved word: }",
+              }));
+  }
+}
+
+TEST_F(IrTest, ParseVerifyErrorsTest) {
+  vector<string> errors;
+  EXPECT_FALSE(Program::Parse(R"""(function foo() -> int {
+entry:
+  $ret 0
+}
+
+function foo() -> int {
+entry:
+  $ret 1
+}
+)""",
+                              &errors)
+                   .has_value());
+  EXPECT_EQ(errors, vector<string>({"Duplicate function name: foo",
+                                    "Program does not have a main function."}));
+
+  // Type errors are reported rather than aborting the parse.
+  EXPECT_FALSE(Program::Parse(R"""(struct Foo {
+  f: int
+}
+
+function main(p:Foo*) -> int {
+entry:
+  x:int = $gep p:Foo* 0 f
+  $ret 0
+}
+)""",
+                              &errors)
+                   .has_value());
+  EXPECT_EQ(errors,
+            vector<string>({"Type error: Result type must be a pointer to "
+                            "type of field: x:int = $gep p:Foo* 0 f"}));
+
+  // A gep whose field is resolved is still checked for assigning to a
+  // special variable.
+  EXPECT_FALSE(Program::Parse(R"""(struct Foo {
+  f: int
+}
+
+function main(p:Foo*) -> int {
+entry:
+  @main:int* = $gep p:Foo* 0 f
+  $ret 0
+}
+)""",
+                              &errors)
+                   .has_value());
+  EXPECT_EQ(errors, vector<string>({"Variables starting with '@' are special "
+                                    "and cannot be assigned to or stored "
+                                    "into"}));
+}
+
+TEST_F(IrTest, SerializeBinaryTest) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      Program program = Program::FromFile(filename);
+      string binary = program.SerializeBinary();
+      EXPECT_LT(binary.size(), program.ToString().size()) << filename;
+      EXPECT_EQ(Program::DeserializeBinary(binary).ToString(),
+                program.ToString())
+          << "FILE: " << filename;
+    }
+  }
+}
+
+// Variables that are different but have the same name, negative and large
+// constants, and empty gep field names must all survive the round trip.
+TEST_F(IrTest, SerializeBinaryVariablesTest) {
+  VarPtr_t other_var = make_shared<Variable>("foo", Type::Int());
+  VarPtr_t null_var = make_shared<Variable>("@nullptr", Type::Int().PtrTo());
+  Function main("main", Type::Int(), {var_},
+                {BasicBlock("entry",
+                            {CopyInst(other_var, -1),
+                             ArithInst(var_, other_var, INT_MIN,
+                                       ArithInst::kAdd),
+                             GepInst(varp_, null_var, INT_MAX, ""),
+                             StoreInst(varp_, var_), RetInst(var_)})});
+  Program program({}, {main});
+
+  Program copy = Program::DeserializeBinary(program.SerializeBinary());
+  EXPECT_EQ(copy.ToString(), program.ToString());
+
+  const auto& entry = copy["main"]["entry"];
+  EXPECT_EQ(entry[1].AsArith().lhs(), copy["main"].parameters()[0]);
+  EXPECT_NE(entry[1].AsArith().lhs(), entry[1].AsArith().op1().GetVar());
+  EXPECT_EQ(entry[3].AsStore().value().GetVar(), entry[1].AsArith().lhs());
+  EXPECT_EQ(entry[1].AsArith().op2().GetInt(), INT_MIN);
+  EXPECT_EQ(entry[2].AsGep().index().GetInt(), INT_MAX);
+  EXPECT_EQ(entry[2].AsGep().src_ptr()->name(), "@nullptr");
+}
+
 TEST_F(IrTest, FromStringGepTest) {
   auto inst1 = Instruction::FromString("x:int* = $gep y:int* z:int foo");
   EXPECT_EQ(inst1.ToString(), "x:int* = $gep y:int* z:int foo\n");
@@ -375,6 +716,376 @@ TEST_F(IrTest, TypeFromToStringTest) {
   EXPECT_EQ(Type::FromString(type).ToString(), type);
 }
 
+TEST_F(IrTest, TypeInterningTest) {
+  EXPECT_EQ(sizeof(Type), sizeof(void*));
+
+  Type type = Type::FromString("foo**[int,int*,bar*[int,int]*]*");
+  Type same = Type::Function({Type::Struct("foo").PtrTo().PtrTo(),
+                              Type::Int(), Type::Int().PtrTo(),
+                              Type::FromString("bar*[int,int]*")})
+                  .PtrTo();
+  EXPECT_EQ(type, same);
+  EXPECT_EQ(std::hash<Type>()(type), std::hash<Type>()(same));
+  EXPECT_EQ(type.Deref().PtrTo(), type);
+  EXPECT_EQ(type.PtrTo().Deref(), type);
+  EXPECT_EQ(type.Deref().GetFuncTypes()[0].Deref().Deref(),
+            Type::Struct("foo"));
+
+  EXPECT_NE(Type::Struct("foo"), Type::Struct("bar"));
+  EXPECT_NE(Type::Struct("foo"), Type::Struct("foo").PtrTo());
+  EXPECT_NE(Type::Function({Type::Int()}),
+            Type::Function({Type::Int(), Type::Int()}));
+  EXPECT_NE(Type::Function({Type::Int()}).PtrTo(), Type::Int().PtrTo());
+  EXPECT_TRUE(Type::Int().PtrTo().Deref().IsInt());
+}
+
+// Threads interning the same new types must all get the same handles.
+TEST_F(IrTest, TypeInterningThreadsTest) {
+  constexpr int kNumThreads = 8;
+  vector<Type> types(kNumThreads);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&types, i] {
+      types[i] = Type::Function({Type::Struct("interned_t").PtrTo(),
+                                 Type::Struct("interned_t")})
+                     .PtrTo()
+                     .PtrTo();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (const Type& type : types) {
+    EXPECT_EQ(type, types[0]);
+    EXPECT_EQ(type.ToString(), "interned_t*[interned_t]**");
+  }
+}
+
+TEST_F(IrTest, SymbolsTest) {
+  Program program = Program::FromString(R"""(function foo(x:int) -> int {
+entry:
+  $jump exit
+
+exit:
+  $ret x:int
+}
+
+function main() -> int {
+entry:
+  x:int = $call foo(1)
+  $ret x:int
+}
+)""");
+  const Function& foo = program["foo"];
+  const Function& main = program["main"];
+
+  // The same names in different places share a symbol.
+  EXPECT_EQ(foo.parameters()[0]->name_symbol(),
+            main["entry"][0].AsCall().lhs()->name_symbol());
+  EXPECT_EQ(foo["entry"][0].AsJump().label_symbol(),
+            foo["exit"].label_symbol());
+  EXPECT_EQ(main["entry"][0].AsCall().callee_symbol(), foo.name_symbol());
+
+  EXPECT_EQ(foo.FindBlock(util::Symbol("exit")), &foo["exit"]);
+  EXPECT_EQ(foo.FindBlock(util::Symbol("nonexistent")), nullptr);
+  EXPECT_EQ(program.FindFunction(util::Symbol("foo")), &foo);
+  EXPECT_EQ(program.FindFunction(util::Symbol("exit")), nullptr);
+
+  // Copies index their own basic blocks.
+  Function copy = foo;
+  EXPECT_EQ(copy.FindBlock(util::Symbol("exit")), &copy["exit"]);
+}
+
+TEST_F(IrTest, DenseIdsTest) {
+  Program program =
+      Program::FromString(R"""(function foo(p:int, q:int*) -> int {
+exit:
+  $ret y:int
+
+entry:
+  x:int = $copy p:int
+  y:int = $arith add x:int 1
+  f:int[int,int*]* = $copy @foo:int[int,int*]*
+  $jump exit
+}
+
+function main() -> int {
+entry:
+  $ret 0
+}
+)""");
+  const Function& foo = program["foo"];
+
+  // Blocks are numbered in layout order, and instructions in order within
+  // each block.
+  ASSERT_EQ(foo.blocks().size(), 2);
+  EXPECT_EQ(foo.blocks()[0], &foo["entry"]);
+  EXPECT_EQ(foo.blocks()[1], &foo["exit"]);
+  for (size_t i = 0; i < foo.blocks().size(); ++i) {
+    EXPECT_EQ(foo.blocks()[i]->id(), i);
+  }
+
+  ASSERT_EQ(foo.instructions().size(), 5);
+  EXPECT_EQ(foo.instructions()[3], &foo["entry"][3]);
+  EXPECT_EQ(foo.instructions()[4], &foo["exit"][0]);
+  for (size_t i = 0; i < foo.instructions().size(); ++i) {
+    EXPECT_EQ(foo.instructions()[i]->id(), i);
+  }
+
+  // The parameters come first, then the other locals in order of appearance;
+  // globals aren't locals.
+  vector<string> locals;
+  for (const auto& var : foo.locals()) locals.push_back(var->name());
+  EXPECT_EQ(locals, vector<string>({"p", "q", "x", "y", "f"}));
+  for (size_t i = 0; i < foo.locals().size(); ++i) {
+    EXPECT_EQ(foo.LocalId(foo.locals()[i]), i);
+  }
+  auto global = foo["entry"][2].AsCopy().rhs().GetVar();
+  EXPECT_EQ(foo.LocalId(global.get()), -1);
+
+  // Copies are numbered the same way, and instructions outside of a function
+  // have no id.
+  Function copy = foo;
+  EXPECT_EQ(copy.instructions()[4], &copy["exit"][0]);
+  EXPECT_EQ(copy["exit"][0].id(), 4);
+  EXPECT_EQ(copy.LocalId(foo.locals()[2]), 2);
+  EXPECT_EQ(Instruction::FromString("$jump exit").id(), -1);
+}
+
+TEST_F(IrTest, LayoutOrderTest) {
+  Function foo = MakeFunction(
+      "foo", {MakeBasicBlock("if.then", {"ret"}),
+              MakeBasicBlock("entry", {"branch"}),
+              MakeBasicBlock("bar", {"ret"}), MakeBasicBlock("foo", {"ret"})});
+
+  // The entry block comes first, and then the others in the order given.
+  vector<string> labels;
+  for (const auto& bb : foo.layout()) labels.push_back(bb.label());
+  EXPECT_EQ(labels, vector<string>({"entry", "if.then", "bar", "foo"}));
+  for (size_t i = 0; i < foo.layout().size(); ++i) {
+    EXPECT_EQ(foo.blocks()[i], &foo.layout()[i]);
+    EXPECT_EQ(foo.FindBlock(foo.layout()[i].label_symbol()),
+              &foo.layout()[i]);
+  }
+  EXPECT_EQ(foo.FindBlock(util::Symbol("if.end")), nullptr);
+
+  // body() still maps the labels to the blocks, in order of label, and
+  // ToString() lists them in that order.
+  labels.clear();
+  for (const auto& [label, bb] : foo.body()) {
+    labels.push_back(label);
+    EXPECT_EQ(bb.get(), &foo[label]);
+  }
+  EXPECT_EQ(labels, vector<string>({"bar", "entry", "foo", "if.then"}));
+  EXPECT_EQ(&foo.body(), &foo.body());
+  EXPECT_LT(foo.ToString().find("bar:"), foo.ToString().find("entry:"));
+
+  // Copies keep the order, and moves keep the blocks where they are.
+  Function copy = foo;
+  EXPECT_EQ(copy.layout()[1].label(), "if.then");
+  EXPECT_EQ(&copy["if.then"], &copy.layout()[1]);
+  EXPECT_EQ(copy.body().at("if.then").get(), &copy.layout()[1]);
+  const BasicBlock* bar = &foo["bar"];
+  Function moved = std::move(foo);
+  EXPECT_EQ(&moved["bar"], bar);
+  EXPECT_EQ(moved.body().at("bar").get(), bar);
+  EXPECT_EQ(bar->parent(), &moved);
+  EXPECT_EQ(moved["entry"][0].AsBranch().target_false(), bar);
+
+  // The pointers in body() keep the blocks alive.
+  BbPtr_t entry;
+  {
+    Function copy = moved;
+    entry = copy.body().at("entry");
+  }
+  EXPECT_EQ(entry->label(), "entry");
+  EXPECT_EQ(entry->body().size(), 1);
+}
+
+TEST_F(IrTest, AssignmentTest) {
+  // Assigned basic blocks are the parents of their instructions.
+  BasicBlock bb = MakeBasicBlock("foo", {"copy", "ret"});
+  BasicBlock copy = MakeBasicBlock("bar", {"ret"});
+  copy = bb;
+  EXPECT_EQ(copy.label(), "foo");
+  ASSERT_EQ(copy.body().size(), 2);
+  EXPECT_EQ(copy[1].parent(), &copy);
+  EXPECT_EQ(bb[1].parent(), &bb);
+
+  const Instruction* inst = &copy[1];
+  BasicBlock moved = MakeBasicBlock("bar", {"ret"});
+  moved = std::move(copy);
+  EXPECT_EQ(&moved[1], inst);
+  EXPECT_EQ(inst->parent(), &moved);
+
+  // So are assigned functions of their blocks, whose jumps and branches go to
+  // their own blocks.
+  Function foo = MakeFunction("foo", {MakeBasicBlock("entry", {"branch"}),
+                                      MakeBasicBlock("foo", {"ret"}),
+                                      MakeBasicBlock("bar", {"ret"})});
+  Function copy_foo = MakeFunction("baz", {MakeBasicBlock("entry", {"ret"})});
+  copy_foo = foo;
+  EXPECT_EQ(copy_foo.name(), "foo");
+  EXPECT_EQ(copy_foo["bar"].parent(), &copy_foo);
+  EXPECT_EQ(copy_foo["entry"][0].AsBranch().target_false(), &copy_foo["bar"]);
+  EXPECT_EQ(copy_foo.body().at("bar").get(), &copy_foo["bar"]);
+  EXPECT_EQ(foo["bar"].parent(), &foo);
+
+  const BasicBlock* bar = &copy_foo["bar"];
+  Function moved_foo = MakeFunction("baz", {MakeBasicBlock("entry", {"ret"})});
+  moved_foo = std::move(copy_foo);
+  EXPECT_EQ(&moved_foo["bar"], bar);
+  EXPECT_EQ(bar->parent(), &moved_foo);
+  EXPECT_EQ(moved_foo.instructions()[0]->parent()->parent(), &moved_foo);
+}
+
+TEST_F(IrTest, ResolvedTargetsTest) {
+  Function foo = Function::FromString(R"""(function foo(p:int) -> int {
+entry:
+  $branch p:int then exit
+
+then:
+  $jump exit
+
+exit:
+  $ret 0
+}
+)""");
+  const auto& branch = foo["entry"][0].AsBranch();
+  EXPECT_EQ(branch.target_true(), &foo["then"]);
+  EXPECT_EQ(branch.target_false(), &foo["exit"]);
+  EXPECT_EQ(foo["then"][0].AsJump().target(), &foo["exit"]);
+
+  // Copies jump to their own blocks, and instructions outside of a function
+  // have no targets.
+  Function copy = foo;
+  EXPECT_EQ(copy["then"][0].AsJump().target(), &copy["exit"]);
+  EXPECT_EQ(copy["entry"][0].AsBranch().target_true(), &copy["then"]);
+  EXPECT_EQ(Instruction::FromString("$jump exit").AsJump().target(), nullptr);
+}
+
+TEST_F(IrTest, ResolvedCalleesTest) {
+  Program program = Program::FromString(R"""(function foo(p:int) -> int {
+entry:
+  x:int = $call input()
+  y:int = $call foo(x:int)
+  $ret y:int
+}
+
+function main() -> int {
+entry:
+  f:int[int]* = $copy @foo:int[int]*
+  x:int = $call foo(1)
+  y:int = $icall f:int[int]*(x:int)
+  $ret y:int
+}
+)""");
+  const Function& foo = program["foo"];
+  const Function& main = program["main"];
+
+  ASSERT_EQ(foo.call_sites().size(), 2);
+  EXPECT_EQ(foo.call_sites()[0]->AsCall().target(), nullptr);
+  EXPECT_EQ(foo.call_sites()[1]->AsCall().target(), &foo);
+
+  ASSERT_EQ(main.call_sites().size(), 2);
+  EXPECT_EQ(main.call_sites()[0]->AsCall().target(), &foo);
+  EXPECT_EQ(main.call_sites()[1]->GetOpcode(), Instruction::kICall);
+
+  // Callers are ordered by the name of the calling function.
+  EXPECT_EQ(foo.callers(), vector<const Instruction*>(
+                               {foo.call_sites()[1], main.call_sites()[0]}));
+  EXPECT_TRUE(main.callers().empty());
+
+  // A function outside of a program has call sites but no callers, and its
+  // calls have no targets.
+  Function copy = foo;
+  EXPECT_EQ(copy.call_sites().size(), 2);
+  EXPECT_EQ(copy.call_sites()[1]->AsCall().target(), nullptr);
+  EXPECT_TRUE(copy.callers().empty());
+
+  // Copies put into another program call the functions in that program.
+  Program other({}, {copy, main});
+  EXPECT_EQ(other["foo"].call_sites()[1]->AsCall().target(), &other["foo"]);
+  EXPECT_EQ(other["main"].call_sites()[0]->AsCall().target(), &other["foo"]);
+}
+
+TEST_F(IrTest, StructLayoutTest) {
+  Program program = Program::FromString(R"""(struct pair {
+  x: int
+  y: int*
+}
+
+struct node {
+  a: pair
+  b: pair
+  next: node*
+}
+
+function main() -> int {
+entry:
+  n:node* = $alloc
+  b:pair* = $gep n:node* 0 b
+  y:int** = $gep b:pair* 0 y
+  c:node* = $gep n:node* 1
+  $ret 0
+}
+)""");
+
+  // Struct types and their fields are indexed by name.
+  ASSERT_EQ(program.structs().size(), 2);
+  const StructLayout& node = program.structs()[0];
+  const StructLayout& pair = program.structs()[1];
+  EXPECT_EQ(node.name().str(), "node");
+  EXPECT_EQ(program.FindStruct(util::Symbol("pair")), &pair);
+  EXPECT_EQ(program.FindStruct(util::Symbol("foo")), nullptr);
+  EXPECT_EQ(node.FieldIndex(util::Symbol("next")), 2);
+  EXPECT_EQ(node.FieldIndex(util::Symbol("x")), -1);
+
+  // Nested structs are flattened.
+  EXPECT_EQ(pair.size(), 2);
+  ASSERT_EQ(node.size(), 5);
+  vector<int> offsets;
+  for (const auto& field : node.fields()) offsets.push_back(field.offset);
+  EXPECT_EQ(offsets, vector<int>({0, 2, 4}));
+  EXPECT_EQ(node.units()[3], Type::Int().PtrTo());
+  EXPECT_EQ(node.units()[4], Type::Struct("node").PtrTo());
+
+  // Geps with a field name have it resolved.
+  const BasicBlock& entry = program["main"]["entry"];
+  EXPECT_EQ(entry[1].AsGep().struct_id(), 0);
+  EXPECT_EQ(entry[1].AsGep().field_index(), 1);
+  EXPECT_EQ(entry[2].AsGep().struct_id(), 1);
+  EXPECT_EQ(entry[2].AsGep().field_index(), 1);
+  EXPECT_EQ(entry[3].AsGep().field_index(), -1);
+
+  // Copies put into another program have their fields resolved again, and
+  // don't keep the field indices from this one.
+  auto struct_types = program.struct_types();
+  struct_types["pair"].erase("y");
+  EXPECT_DEATH(Program(struct_types, {program["main"]}),
+               "mismatch between struct type and field name");
+
+  // A struct can only contain itself through a pointer.
+  vector<string> errors;
+  EXPECT_FALSE(Program::Parse(R"""(struct foo {
+  bar: bar
+}
+
+struct bar {
+  foo: foo
+}
+
+function main() -> int {
+entry:
+  $ret 0
+}
+)""",
+                              &errors));
+  ASSERT_EQ(errors.size(), 2);
+  for (const string& error : errors) {
+    EXPECT_TRUE(error.find("can't contain itself") != string::npos) << error;
+  }
+}
+
 TEST_F(IrTest, InstIndexInBasicBlockTest) {
   auto bb = MakeBasicBlock(
       "entry", {"arith", "cmp", "phi", "copy", "alloc", "load", "jump"});
@@ -418,6 +1129,66 @@ Basic block 'fun::bar' jumps to nonexistent basic block 'foo'
 Type uses nonexistent struct: foo)""");
 }
 
+TEST_F(IrDeathTest, FromStreamLineNumbers) {
+  std::istringstream in(R"""(function foo() -> int {
+entry:
+  $ret 0
+}
+
+function main() -> int {
+entry:
+  x:int = $copy
+  $ret 0
+}
+)""");
+  EXPECT_DEATH(Program::FromStream(in, 8), "line 9");
+}
+
+TEST_F(IrDeathTest, FromStringParallelLineNumbers) {
+  EXPECT_DEATH(Program::FromString(R"""(function foo() -> int {
+entry:
+  $ret 0
+}
+
+function main() -> int {
+entry:
+  x:int = $copy
+  $ret 0
+}
+)""",
+                                   {2}),
+               "line 9");
+}
+
+TEST_F(IrDeathTest, FromStreamStructAfterFunction) {
+  std::istringstream in(R"""(function main() -> int {
+entry:
+  $ret 0
+}
+
+struct foo {
+  x: int
+}
+)""");
+  EXPECT_DEATH(Program::FromStream(in), "unexpected token struct");
+}
+
+TEST_F(IrDeathTest, DeserializeBinaryMalformed) {
+  string binary = Program::FromString(R"""(function main() -> int {
+entry:
+  $ret 0
+}
+)""")
+                      .SerializeBinary();
+
+  EXPECT_DEATH(Program::DeserializeBinary("nonsense"), "Not a binary IR image");
+  EXPECT_DEATH(Program::DeserializeBinary(binary.substr(0, binary.size() - 1)),
+               "Malformed binary IR");
+
+  binary[3]++;
+  EXPECT_DEATH(Program::DeserializeBinary(binary), "Unsupported binary IR");
+}
+
 // FIXME: need death tests for typechecking
 
 }  // namespace
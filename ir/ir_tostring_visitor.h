@@ -2,157 +2,228 @@
 
 #include "ir/ir.h"
 #include "ir/irvisitor.h"
+#include "util/buffered_writer.h"
 
 namespace ir {
 
+// Prints IR in the text format read by the FromString() methods. The text is
+// streamed straight to a util::BufferedWriter, which may write to a string, a
+// stream, or a file descriptor; types, variables, and operands are written
+// piece by piece rather than first being built up as strings.
 class ToStringVisitor : public IrVisitor {
  public:
-  // Returns the string representation and resets the visitor.
+  // Prints to a string, which GetString() returns.
+  ToStringVisitor() : out_(string_writer_) {}
+
+  // Prints to 'out', which must outlive this visitor.
+  explicit ToStringVisitor(util::BufferedWriter* out) : out_(*out) {}
+
+  // Returns the string representation and resets the visitor. Only valid for
+  // a visitor that prints to a string.
   string GetString() {
-    string retval = out_.str();
-    out_.clear();
+    CHECK_EQ(&out_, &string_writer_) << "Not printing to a string";
+    string retval = std::move(str_);
+    str_.clear();
     return retval;
   }
 
   void VisitProgram(const Program& program) override {
     for (const auto& [name, fields] : program.struct_types()) {
-      out_ << "struct " << name << " {" << std::endl;
+      out_ << "struct " << name << " {\n";
       for (const auto& [fieldname, fieldtype] : fields) {
-        out_ << "  " << fieldname << ": " << fieldtype << std::endl;
+        out_ << "  " << fieldname << ": ";
+        WriteType(fieldtype);
+        out_ << '\n';
       }
-      out_ << "}" << std::endl << std::endl;
+      out_ << "}\n\n";
     }
   }
 
   void VisitFunction(const Function& function) override {
     out_ << "function " << function.name() << "(";
-    if (!function.parameters().empty()) {
-      vector<string> params;
-      for (const auto& param : function.parameters()) {
-        params.push_back(param->ToString());
-      }
-      std::copy(params.begin(), std::prev(params.end()),
-                std::ostream_iterator<string>(out_, ", "));
-      out_ << *params.rbegin();
-    }
-    out_ << ") -> " << function.return_type().ToString() << " {";
+    WriteList(function.parameters(), ", ");
+    out_ << ") -> ";
+    WriteType(function.return_type());
+    out_ << " {";
   }
 
   void VisitFunctionPost(const Function& function) override {
-    out_ << "}" << std::endl << std::endl;
+    out_ << "}\n\n";
   }
 
   void VisitBasicBlock(const BasicBlock& basic_block) override {
-    out_ << std::endl << basic_block.label() << ":" << std::endl;
+    out_ << '\n' << basic_block.label() << ":\n";
     indent_ = "  ";
   }
 
   void VisitInst(const ArithInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $arith "
-         << aop_to_str_.at(inst.operation()) << " " << inst.op1().ToString()
-         << " " << inst.op2().ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$arith ");
+    out_ << aop_to_str_.at(inst.operation()) << ' ';
+    Write(inst.op1());
+    out_ << ' ';
+    Write(inst.op2());
+    out_ << '\n';
   }
 
   void VisitInst(const CmpInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $cmp "
-         << rop_to_str_.at(inst.operation()) << " " << inst.op1().ToString()
-         << " " << inst.op2().ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$cmp ");
+    out_ << rop_to_str_.at(inst.operation()) << ' ';
+    Write(inst.op1());
+    out_ << ' ';
+    Write(inst.op2());
+    out_ << '\n';
   }
 
   void VisitInst(const PhiInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $phi(";
-    vector<string> ops;
-    for (const auto& op : inst.ops()) {
-      ops.push_back(op.ToString());
-    }
-    std::copy(ops.begin(), std::prev(ops.end()),
-              std::ostream_iterator<string>(out_, ", "));
-    out_ << *ops.rbegin() << ")" << std::endl;
+    WriteLhs(inst.lhs(), "$phi(");
+    WriteList(inst.ops(), ", ");
+    out_ << ")\n";
   }
 
   void VisitInst(const CopyInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $copy "
-         << inst.rhs().ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$copy ");
+    Write(inst.rhs());
+    out_ << '\n';
   }
 
   void VisitInst(const AllocInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $alloc" << std::endl;
+    WriteLhs(inst.lhs(), "$alloc\n");
   }
 
   void VisitInst(const AddrOfInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $addrof "
-         << inst.rhs()->ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$addrof ");
+    Write(inst.rhs());
+    out_ << '\n';
   }
 
   void VisitInst(const LoadInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $load "
-         << inst.src()->ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$load ");
+    Write(inst.src());
+    out_ << '\n';
   }
 
   void VisitInst(const StoreInst& inst) override {
-    out_ << indent_ << "$store " << inst.dst()->ToString() << " "
-         << inst.value().ToString() << std::endl;
+    out_ << indent_ << "$store ";
+    Write(inst.dst());
+    out_ << ' ';
+    Write(inst.value());
+    out_ << '\n';
   }
 
   void VisitInst(const GepInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $gep "
-         << inst.src_ptr()->ToString() << " " << inst.index().ToString();
-    if (inst.field_name() != "") out_ << " " << inst.field_name();
-    out_ << std::endl;
+    WriteLhs(inst.lhs(), "$gep ");
+    Write(inst.src_ptr());
+    out_ << ' ';
+    Write(inst.index());
+    if (inst.field_name() != "") out_ << ' ' << inst.field_name();
+    out_ << '\n';
   }
 
   void VisitInst(const SelectInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $select "
-         << inst.condition().ToString() << " " << inst.true_op().ToString()
-         << " " << inst.false_op().ToString() << std::endl;
+    WriteLhs(inst.lhs(), "$select ");
+    Write(inst.condition());
+    out_ << ' ';
+    Write(inst.true_op());
+    out_ << ' ';
+    Write(inst.false_op());
+    out_ << '\n';
   }
 
   void VisitInst(const CallInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $call " << inst.callee()
-         << "(";
-    if (!inst.args().empty()) {
-      vector<string> args;
-      for (const auto& arg : inst.args()) {
-        args.push_back(arg.ToString());
-      }
-      std::copy(args.begin(), std::prev(args.end()),
-                std::ostream_iterator<string>(out_, ", "));
-      out_ << *args.rbegin();
-    }
-    out_ << ")" << std::endl;
+    WriteLhs(inst.lhs(), "$call ");
+    out_ << inst.callee() << '(';
+    WriteList(inst.args(), ", ");
+    out_ << ")\n";
   }
 
   void VisitInst(const ICallInst& inst) override {
-    out_ << indent_ << inst.lhs()->ToString() << " = $icall "
-         << inst.func_ptr()->ToString() << "(";
-    if (!inst.args().empty()) {
-      vector<string> args;
-      for (const auto& arg : inst.args()) {
-        args.push_back(arg.ToString());
-      }
-      std::copy(args.begin(), std::prev(args.end()),
-                std::ostream_iterator<string>(out_, ", "));
-      out_ << *args.rbegin();
-    }
-    out_ << ")" << std::endl;
+    WriteLhs(inst.lhs(), "$icall ");
+    Write(inst.func_ptr());
+    out_ << '(';
+    WriteList(inst.args(), ", ");
+    out_ << ")\n";
   }
 
   void VisitInst(const RetInst& inst) override {
-    out_ << indent_ << "$ret " << inst.retval().ToString() << std::endl;
+    out_ << indent_ << "$ret ";
+    Write(inst.retval());
+    out_ << '\n';
   }
 
   void VisitInst(const JumpInst& inst) override {
-    out_ << indent_ << "$jump " << inst.label() << std::endl;
+    out_ << indent_ << "$jump " << inst.label() << '\n';
   }
 
   void VisitInst(const BranchInst& inst) override {
-    out_ << indent_ << "$branch " << inst.condition().ToString() << " "
-         << inst.label_true() << " " << inst.label_false() << std::endl;
+    out_ << indent_ << "$branch ";
+    Write(inst.condition());
+    out_ << ' ' << inst.label_true() << ' ' << inst.label_false() << '\n';
   }
 
  private:
-  // The string representation.
-  std::ostringstream out_;
+  // Writes the same text as Type::ToString().
+  void WriteType(const Type& type) {
+    switch (type.BaseKind()) {
+      case Type::kInt:
+        out_ << "int";
+        break;
+
+      case Type::kStruct:
+        out_ << type.GetStructName();
+        break;
+
+      case Type::kFunc: {
+        const auto& types = type.GetFuncTypes();
+        WriteType(types[0]);
+        out_ << '[';
+        for (size_t i = 1; i < types.size(); ++i) {
+          if (i > 1) out_ << ',';
+          WriteType(types[i]);
+        }
+        out_ << ']';
+        break;
+      }
+    }
+    out_.Repeat('*', type.indirection());
+  }
+
+  // Writes the same text as Variable::ToString() and Operand::ToString().
+  void Write(const VarPtr_t& var) {
+    out_ << var->name() << ':';
+    WriteType(var->type());
+  }
+
+  void Write(const Operand& op) {
+    if (op.IsVariable()) {
+      Write(op.GetVar());
+    } else {
+      out_ << op.GetInt();
+    }
+  }
+
+  // Writes the elements of 'items' separated by 'separator'.
+  template <typename T>
+  void WriteList(const vector<T>& items, std::string_view separator) {
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (i > 0) out_ << separator;
+      Write(items[i]);
+    }
+  }
+
+  // Writes the start of an instruction that assigns to 'lhs', up to and
+  // including 'rest'.
+  void WriteLhs(const VarPtr_t& lhs, std::string_view rest) {
+    out_ << indent_;
+    Write(lhs);
+    out_ << " = " << rest;
+  }
+
+  // The output when printing to a string, and the writer for it.
+  string str_;
+  util::BufferedWriter string_writer_{&str_};
+
+  // Where the text is written: either string_writer_ or a caller's writer.
+  util::BufferedWriter& out_;
 
   // The indentation for instructions. Initially empty, in case we're only
   // visiting instructions and not basic blocks; if we ever visit a basic block
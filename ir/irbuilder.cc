@@ -47,16 +47,24 @@ Builder& Builder::AddInstruction(const Instruction& inst) {
   return *this;
 }
 
+Builder& Builder::AddInstruction(Instruction&& inst) {
+  CHECK_NE(curr_bb_label_, "")
+      << "Cannot add an instruction outside a basic block: " << inst.ToString();
+  curr_bb_body_.push_back(std::move(inst));
+  return *this;
+}
+
 Program Builder::FinalizeProgram() {
   FinalizeCurrentBasicBlock();
   FinalizeCurrentFunction();
-  return Program(struct_types_, functions_);
+  return Program(struct_types_, std::move(functions_));
 }
 
 void Builder::FinalizeCurrentFunction() {
   CHECK_NE(curr_function_name_, "") << "Cannot finalize a nonexistent function";
   functions_.emplace_back(curr_function_name_, curr_function_rettype_,
-                          curr_function_parameters_, curr_function_body_);
+                          curr_function_parameters_,
+                          std::move(curr_function_body_));
   curr_function_name_ = "";
   curr_function_rettype_ = Type::Int();
   curr_function_parameters_.clear();
@@ -65,7 +73,7 @@ void Builder::FinalizeCurrentFunction() {
 
 void Builder::FinalizeCurrentBasicBlock() {
   CHECK_NE(curr_bb_label_, "") << "Cannot finalize a nonexistent basic block";
-  curr_function_body_.emplace_back(curr_bb_label_, curr_bb_body_);
+  curr_function_body_.emplace_back(curr_bb_label_, std::move(curr_bb_body_));
   curr_bb_label_ = "";
   curr_bb_body_.clear();
 }
@@ -26,6 +26,7 @@ class Builder {
 
   // Adds a new instruction to the currently ongoing basic block.
   Builder& AddInstruction(const Instruction& inst);
+  Builder& AddInstruction(Instruction&& inst);
 
   // Takes all of the information given so far and uses it to build and return a
   // Program.
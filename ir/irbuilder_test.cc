@@ -2,8 +2,60 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <new>
+
 #include "ir/ir_tostring_visitor.h"
 
+// The number of heap allocations made so far by this process. Every form of
+// the global operator new and delete is replaced, so that each new is paired
+// with a matching delete.
+std::atomic<size_t> num_allocations = 0;
+
+// Not inlined, so that the compiler doesn't pair the malloc() in one with the
+// operator delete that calls the other (-Wmismatched-new-delete).
+[[gnu::noinline]] static void* CountedAlloc(
+    size_t size, size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+  ++num_allocations;
+  if (size == 0) size = 1;
+  void* ptr = nullptr;
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    ptr = std::malloc(size);
+  } else if (posix_memalign(&ptr, alignment, size) != 0) {
+    ptr = nullptr;
+  }
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+[[gnu::noinline]] static void CountedFree(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+
 namespace {
 
 using namespace ir;
@@ -42,6 +94,41 @@ foo:
 )""");
 }
 
+// Builds a program whose main function calls 'foo' 'num_calls' times, and
+// returns the number of allocations made doing so.
+size_t CountBuildAllocations(int num_calls) {
+  VarPtr_t x = make_shared<Variable>("x", Type::Int());
+  VarPtr_t y = make_shared<Variable>("y", Type::Int());
+
+  size_t before = num_allocations;
+  Builder builder;
+  builder.StartFunction("foo", Type::Int())
+      .AddParameter(x)
+      .AddParameter(y)
+      .StartBasicBlock("entry")
+      .AddInstruction(RetInst(x))
+      .StartFunction("main", Type::Int())
+      .StartBasicBlock("entry")
+      .AddInstruction(CopyInst(x, 0))
+      .AddInstruction(CopyInst(y, 1));
+  for (int i = 0; i < num_calls; i++) {
+    builder.AddInstruction(CallInst(x, "foo", {x, y}));
+  }
+  builder.AddInstruction(RetInst(x));
+  Program program = builder.FinalizeProgram();
+  return num_allocations - before;
+}
+
+// Instructions are moved rather than copied on their way into a program, so
+// each call costs only the allocation of its argument list (plus amortized
+// growth of the containers holding the instructions).
+TEST(BuilderTest, AllocationsPerInstruction) {
+  CountBuildAllocations(1);  // To intern the names.
+  size_t small = CountBuildAllocations(1000);
+  size_t large = CountBuildAllocations(2000);
+  EXPECT_LE(large - small, 1100) << small << " " << large;
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ir/ir.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// A stored program (e.g., in a file) whose functions can be read one at a time;
+// see BinaryImage, TextImage, and ProgramView.
+class ProgramImage {
+ public:
+  virtual ~ProgramImage() = default;
+
+  virtual const map<string, map<string, Type>>& struct_types() const = 0;
+
+  // The names of the functions, in the order they are stored.
+  virtual const vector<string>& function_names() const = 0;
+
+  // The types of the functions (see FunctionType()), in the same order.
+  virtual const vector<Type>& function_types() const = 0;
+
+  // The global variables that the image stores up front, in a table shared by
+  // all its functions (empty if the format has no such table, in which case
+  // globals are interned by name as functions are read).
+  virtual const vector<VarPtr_t>& globals() const = 0;
+
+  // Reads and returns the function with the given index (in function_names()),
+  // without verifying it; FATALs if it is malformed. Global variables are
+  // shared by all the functions read from the same image. Thread-safe.
+  virtual Function ReadFunction(int index) const = 0;
+};
+
+}  // namespace ir
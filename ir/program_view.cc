@@ -0,0 +1,76 @@
+#include "ir/program_view.h"
+
+#include "ir/ir_binary.h"
+#include "ir/text_image.h"
+
+namespace ir {
+
+namespace {
+
+// Returns an image of the program in 'data', which is in the binary format if
+// it starts with the binary format's magic bytes and in the text format
+// otherwise.
+unique_ptr<const ProgramImage> MakeImage(std::string_view data) {
+  if (data.substr(0, kBinaryMagic.size()) == kBinaryMagic) {
+    return make_unique<BinaryImage>(data);
+  }
+  return make_unique<TextImage>(data);
+}
+
+}  // namespace
+
+ProgramView::ProgramView(std::string_view image)
+    : ProgramView(nullptr, image) {}
+
+ProgramView::ProgramView(unique_ptr<util::MappedFile> file,
+                         std::string_view image)
+    : file_(std::move(file)),
+      image_(MakeImage(image)),
+      functions_(image_->function_names().size()),
+      decoded_(new std::once_flag[functions_.size()]) {
+  int num_functions = image_->function_names().size();
+  for (int i = 0; i < num_functions; i++) {
+    const string& name = image_->function_names()[i];
+    CHECK(function_index_.emplace(name, i).second)
+        << "cannot have duplicate function names";
+    function_types_[name] = image_->function_types()[i];
+  }
+
+  CHECK(HasFunction("main")) << "Program does not have a main function.";
+
+  // Each function is verified when it is read, but the struct types and the
+  // globals that the functions share only need to be verified once.
+  string errs = VerifyStructTypes(struct_types());
+  errs += VerifyGlobals(image_->globals(), struct_types(), function_types_);
+  CHECK_EQ(errs, "") << "Malformed program:" << std::endl << errs;
+}
+
+unique_ptr<ProgramView> ProgramView::FromFile(const string& path) {
+  auto file = make_unique<util::MappedFile>(path);
+  std::string_view image = file->contents();
+  return unique_ptr<ProgramView>(new ProgramView(std::move(file), image));
+}
+
+const Function& ProgramView::operator[](const string& name) const {
+  auto it = function_index_.find(name);
+  CHECK(it != function_index_.end()) << "unknown function name";
+  int index = it->second;
+
+  std::call_once(decoded_[index], [&]() {
+    auto function = make_unique<const Function>(image_->ReadFunction(index));
+    string errs = VerifyFunction(*function, struct_types(), function_types_);
+    CHECK_EQ(errs, "") << "Malformed function: " << name << std::endl << errs;
+    functions_[index] = std::move(function);
+  });
+
+  return *functions_[index];
+}
+
+Program ProgramView::ToProgram() const {
+  vector<Function> functions;
+  functions.reserve(function_names().size());
+  for (const auto& name : function_names()) functions.push_back((*this)[name]);
+  return Program(struct_types(), std::move(functions));
+}
+
+}  // namespace ir
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <mutex>
+#include <string_view>
+
+#include "ir/ir.h"
+#include "ir/program_image.h"
+#include "util/mapped_file.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// A read-only view of a stored program, typically a memory-mapped file in
+// either the binary format written by Program::SerializeBinary() (see
+// BinaryImage) or the text format written by Program::ToString() (see
+// TextImage). Creating a view only reads what is needed to find the program's
+// functions; each function is read and verified the first time it is
+// requested, so the cost of using a view scales with the functions used rather
+// than with the size of the program. As in a Program, the global variables are
+// shared by all of a view's functions. Thread-safe.
+//
+// The struct types and the globals are verified when the view is created.
+// Unlike a Program's, a view's functions are read independently of each other,
+// so calls are not resolved: CallInst::target() is null and Function::callers()
+// is empty (use ToProgram() for those).
+class ProgramView {
+ public:
+  // Views 'image' (in either format), which is not copied (so it must outlive
+  // the view). FATALs if the image is malformed.
+  explicit ProgramView(std::string_view image);
+
+  // Returns a view of the IR file at 'path' (in either format), which stays
+  // memory-mapped for the lifetime of the view.
+  static unique_ptr<ProgramView> FromFile(const string& path);
+
+  ProgramView(const ProgramView&) = delete;
+  ProgramView& operator=(const ProgramView&) = delete;
+
+  const map<string, map<string, Type>>& struct_types() const {
+    return image_->struct_types();
+  }
+
+  // The names of the program's functions, in the order they are stored (which
+  // is alphabetical for images written by SerializeBinary() or ToString()).
+  const vector<string>& function_names() const {
+    return image_->function_names();
+  }
+
+  bool HasFunction(const string& name) const {
+    return function_index_.count(name) != 0;
+  }
+
+  // Returns the function with the given name, reading and verifying it first if
+  // this is the first time it has been requested; FATALs if no such function
+  // exists or it is malformed.
+  const Function& operator[](const string& name) const;
+
+  // Returns the whole program, reading any functions that haven't been yet.
+  Program ToProgram() const;
+
+ private:
+  ProgramView(unique_ptr<util::MappedFile> file, std::string_view image);
+
+  // If the view owns the mapping of its image, the mapped file.
+  unique_ptr<util::MappedFile> file_;
+
+  unique_ptr<const ProgramImage> image_;
+
+  // Function name ==> index in the image, and function name ==> type (for
+  // verifying calls without decoding the callee).
+  unordered_map<string, int> function_index_;
+  map<string, Type> function_types_;
+
+  // The functions read so far, by index, and flags to make sure each is only
+  // read once.
+  mutable vector<unique_ptr<const Function>> functions_;
+  unique_ptr<std::once_flag[]> decoded_;
+};
+
+}  // namespace ir
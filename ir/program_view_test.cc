@@ -0,0 +1,203 @@
+#include "ir/program_view.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+using namespace ir;
+
+// Returns whether 'str' ends in 'suffix'.
+bool EndsWith(const string& str, const string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), string::npos, suffix) == 0;
+}
+
+// Writes 'contents' to a new temporary file and returns its name.
+string WriteTempFile(const string& contents) {
+  string filename = std::filesystem::temp_directory_path() /
+                    ("program_view_test." + std::to_string(std::rand()));
+  std::ofstream out(filename, std::ios::binary);
+  out << contents;
+  return filename;
+}
+
+const char kProgram[] = R"""(struct node {
+  next: node*
+}
+
+function foo(n:node*) -> node* {
+entry:
+  x:node* = $copy @nullptr:node*
+  fp:node*[node*]* = $copy @foo:node*[node*]*
+  $ret x:node*
+}
+
+function main() -> int {
+entry:
+  p:node* = $copy @nullptr:node*
+  q:node* = $call foo(p:node*)
+  fp:node*[node*]* = $copy @foo:node*[node*]*
+  $ret 0
+}
+)""";
+
+TEST(ProgramViewTest, TestData) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      Program program = Program::FromFile(filename);
+      string binary_filename = WriteTempFile(program.SerializeBinary());
+
+      {
+        auto view = ProgramView::FromFile(binary_filename);
+        EXPECT_EQ(view->struct_types(), program.struct_types());
+        ASSERT_EQ(view->function_names().size(), program.functions().size());
+        for (const auto& [name, function] : program.functions()) {
+          ASSERT_TRUE(view->HasFunction(name));
+          EXPECT_EQ((*view)[name].ToString(), function->ToString())
+              << "FILE: " << filename;
+        }
+        EXPECT_EQ(view->ToProgram().ToString(), program.ToString());
+      }
+
+      std::filesystem::remove(binary_filename);
+    }
+  }
+}
+
+TEST(ProgramViewTest, TextTestData) {
+  for (const auto& dir_entry :
+       std::filesystem::directory_iterator("ir/testdata/")) {
+    string filename = dir_entry.path();
+    if (EndsWith(filename, ".ir")) {
+      Program program = Program::FromFile(filename);
+      auto view = ProgramView::FromFile(filename);
+      EXPECT_EQ(view->struct_types(), program.struct_types());
+      ASSERT_EQ(view->function_names().size(), program.functions().size());
+      for (const auto& [name, function] : program.functions()) {
+        ASSERT_TRUE(view->HasFunction(name));
+        EXPECT_EQ((*view)[name].ToString(), function->ToString())
+            << "FILE: " << filename;
+      }
+      EXPECT_EQ(view->ToProgram().ToString(), program.ToString());
+    }
+  }
+}
+
+// Only the functions that are used are parsed and verified.
+TEST(ProgramViewDeathTest, TextParsedLazily) {
+  string text = kProgram;
+  text += R"""(
+function unused(x:int) -> int {
+entry:
+  y:int = $arith pow x:int 2
+  $ret y:int
+}
+)""";
+  ProgramView view(text);
+
+  EXPECT_TRUE(view.HasFunction("unused"));
+  EXPECT_EQ(view["main"].ToString(),
+            Program::FromString(kProgram)["main"].ToString());
+  EXPECT_DEATH(view["unused"], "line 22: unknown arithmetic operation: pow");
+}
+
+TEST(ProgramViewTest, DecodesOnce) {
+  string binary = Program::FromString(kProgram).SerializeBinary();
+  ProgramView view(binary);
+
+  EXPECT_FALSE(view.HasFunction("bar"));
+  EXPECT_EQ(&view["foo"], &view["foo"]);
+
+  // Concurrent first requests all get the same function.
+  vector<const Function*> mains(4);
+  vector<std::thread> threads;
+  for (size_t i = 0; i < mains.size(); i++) {
+    threads.emplace_back([&, i]() { mains[i] = &view["main"]; });
+  }
+  for (auto& thread : threads) thread.join();
+  for (const Function* main : mains) EXPECT_EQ(main, mains[0]);
+}
+
+// Functions decoded separately still share global variables.
+TEST(ProgramViewTest, SharedGlobals) {
+  string binary = Program::FromString(kProgram).SerializeBinary();
+  for (std::string_view image : {std::string_view(binary),
+                                 std::string_view(kProgram)}) {
+    ProgramView view(image);
+
+    const auto& foo_entry = view["foo"]["entry"];
+    const auto& main_entry = view["main"]["entry"];
+    EXPECT_EQ(foo_entry[0].AsCopy().rhs().GetVar(),
+              main_entry[0].AsCopy().rhs().GetVar());
+    EXPECT_EQ(foo_entry[1].AsCopy().rhs().GetVar(),
+              main_entry[2].AsCopy().rhs().GetVar());
+  }
+}
+
+// Calls are checked against the types of functions that haven't been read.
+TEST(ProgramViewDeathTest, TextVerifiedPerFunction) {
+  ProgramView view(R"""(function foo(x:int) -> int {
+entry:
+  $ret x:int
+}
+
+function main() -> int {
+entry:
+  x:int = $call foo()
+  $ret x:int
+}
+)""");
+  EXPECT_DEATH(view["main"], "incorrect number of call arguments");
+}
+
+// Struct types and globals are verified when the view is created, rather than
+// with each function.
+TEST(ProgramViewDeathTest, TablesVerifiedUpFront) {
+  EXPECT_DEATH(ProgramView(R"""(struct node {
+  next: node
+}
+
+function main() -> int {
+entry:
+  $ret 0
+}
+)"""),
+               "Struct type can't contain itself");
+
+  // Rename the global function pointer @foo (which only the globals table
+  // refers to by name) so that it looks like a local.
+  string binary = Program::FromString(kProgram).SerializeBinary();
+  size_t pos = binary.find("@foo");
+  ASSERT_NE(pos, string::npos);
+  binary[pos] = 'x';
+  EXPECT_DEATH(ProgramView{binary}, "Global variable names must start with");
+}
+
+// Functions are read independently, so calls aren't resolved.
+TEST(ProgramViewTest, CallsNotResolved) {
+  ProgramView view(kProgram);
+  EXPECT_EQ(view["main"]["entry"][1].AsCall().target(), nullptr);
+  EXPECT_TRUE(view["foo"].callers().empty());
+  EXPECT_NE(view.ToProgram()["main"]["entry"][1].AsCall().target(), nullptr);
+}
+
+TEST(ProgramViewDeathTest, UnknownFunction) {
+  string binary = Program::FromString(kProgram).SerializeBinary();
+  ProgramView view(binary);
+  EXPECT_DEATH(view["bar"], "unknown function name");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string_view>
+
+#include "ir/ir.h"
+#include "ir/program_image.h"
+#include "util/standard_includes.h"
+
+namespace ir {
+
+// Shares global variables between parsers; defined in ir.cc.
+class SharedGlobals;
+
+// A program in the text format (as output by Program::ToString()) that is
+// indexed rather than parsed up front: a quick scan that only matches braces
+// finds the text of each struct type and function definition, then the struct
+// types and the function headers (names and types) are read, and each function
+// body is only parsed when it is requested. The text is not copied, so it must
+// outlive the image. FATALs if the text is malformed.
+//
+// Implemented in ir.cc, along with the rest of the parser.
+class TextImage : public ProgramImage {
+ public:
+  explicit TextImage(std::string_view text);
+  ~TextImage() override;
+
+  const map<string, map<string, Type>>& struct_types() const override {
+    return struct_types_;
+  }
+
+  const vector<string>& function_names() const override {
+    return function_names_;
+  }
+
+  const vector<Type>& function_types() const override {
+    return function_types_;
+  }
+
+  // The text format has no globals table.
+  const vector<VarPtr_t>& globals() const override { return no_globals_; }
+
+  Function ReadFunction(int index) const override;
+
+ private:
+  map<string, map<string, Type>> struct_types_;
+
+  // The name and type of each function, and its text along with the line on
+  // which that starts.
+  vector<string> function_names_;
+  vector<Type> function_types_;
+  vector<pair<std::string_view, int>> function_text_;
+
+  unique_ptr<SharedGlobals> globals_;
+  const vector<VarPtr_t> no_globals_;
+};
+
+}  // namespace ir
@@ -0,0 +1,42 @@
+#include "util/arena.h"
+
+namespace util {
+
+Arena::Arena(size_t first_chunk_size) : next_chunk_size_(first_chunk_size) {
+  CHECK_GT(first_chunk_size, 0) << "first_chunk_size must be positive";
+}
+
+Arena::~Arena() {
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->destroy(it->object);
+  }
+}
+
+void Arena::Adopt(Arena&& other) {
+  CHECK_NE(this, &other) << "An arena can't adopt itself";
+
+  // Allocation continues in this arena's last chunk, which is no longer the
+  // last one in 'chunks_'; AllocateSlow() doesn't mind.
+  chunks_.insert(chunks_.end(), std::make_move_iterator(other.chunks_.begin()),
+                 std::make_move_iterator(other.chunks_.end()));
+  destructors_.insert(destructors_.end(), other.destructors_.begin(),
+                      other.destructors_.end());
+  other.chunks_.clear();
+  other.destructors_.clear();
+  other.next_ = other.end_ = nullptr;
+}
+
+void* Arena::AllocateSlow(size_t size, size_t alignment) {
+  CHECK_LE(alignment, alignof(std::max_align_t)) << "Unsupported alignment";
+
+  // new[] aligns to alignof(std::max_align_t), so the chunk needs no padding.
+  size_t chunk_size = std::max(next_chunk_size_, size);
+  next_chunk_size_ = std::min(2 * next_chunk_size_, kMaxChunkSize);
+
+  chunks_.emplace_back(new char[chunk_size]);
+  next_ = chunks_.back().get();
+  end_ = next_ + chunk_size;
+  return next_;
+}
+
+}  // namespace util
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include "util/standard_includes.h"
+
+namespace util {
+
+// A region that objects are allocated from one after another, in chunks that
+// grow geometrically, and that are all freed together when the arena is
+// destroyed. Allocating is a pointer bump and freeing costs one free() per
+// chunk, so an arena suits many small objects that live and die together.
+// Objects that aren't trivially destructible have their destructors run (in
+// reverse order of construction) when the arena is destroyed. Not thread-safe.
+class Arena {
+ public:
+  static constexpr size_t kDefaultFirstChunkSize = 256;
+  static constexpr size_t kMaxChunkSize = 1 << 16;
+
+  explicit Arena(size_t first_chunk_size = kDefaultFirstChunkSize);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns 'size' bytes of uninitialized memory aligned to 'alignment' (which
+  // must be a power of two no larger than alignof(std::max_align_t)).
+  void* Allocate(size_t size, size_t alignment) {
+    char* ptr = reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(next_) + alignment - 1) & -alignment);
+    if (ptr + size > end_ || next_ == nullptr) {
+      ptr = static_cast<char*>(AllocateSlow(size, alignment));
+    }
+    next_ = ptr + size;
+    return ptr;
+  }
+
+  // Constructs a T in the arena.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    T* object = new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back({object, [](const void* object) {
+                                static_cast<const T*>(object)->~T();
+                              }});
+    }
+    return object;
+  }
+
+  // Takes over the chunks of 'other' and the objects in them, leaving 'other'
+  // empty; they're freed along with this arena instead (the objects of 'other'
+  // first). Lets threads fill arenas of their own and then merge them.
+  void Adopt(Arena&& other);
+
+  // Returns the number of chunks allocated so far.
+  size_t num_chunks() const { return chunks_.size(); }
+
+ private:
+  // Allocates a new chunk big enough for 'size' bytes aligned to 'alignment',
+  // and returns them.
+  void* AllocateSlow(size_t size, size_t alignment);
+
+  // The chunks, and the free space at the end of the last one.
+  vector<unique_ptr<char[]>> chunks_;
+  char* next_ = nullptr;
+  char* end_ = nullptr;
+
+  // The size of the next chunk to allocate (unless an allocation needs more).
+  size_t next_chunk_size_;
+
+  // The objects to destroy along with the arena, in order of construction.
+  struct Destructor {
+    const void* object;
+    void (*destroy)(const void*);
+  };
+  vector<Destructor> destructors_;
+};
+
+// Like make_shared(), but constructs the object in 'arena'. The result shares
+// ownership of the whole arena rather than owning just the object, so the
+// arena (and everything in it) lives as long as any pointer made this way.
+template <typename T, typename... Args>
+shared_ptr<T> MakeShared(const shared_ptr<Arena>& arena, Args&&... args) {
+  return shared_ptr<T>(arena, arena->New<T>(std::forward<Args>(args)...));
+}
+
+}  // namespace util
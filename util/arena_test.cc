@@ -0,0 +1,106 @@
+// Tests for the arena.
+
+#include "arena.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace util;
+
+TEST(ArenaTest, Allocate) {
+  Arena arena;
+  char* c = static_cast<char*>(arena.Allocate(1, 1));
+  double* d = static_cast<double*>(arena.Allocate(sizeof(double), 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(d) % 8, 0);
+  EXPECT_GT(reinterpret_cast<char*>(d), c);
+  EXPECT_EQ(arena.num_chunks(), 1);
+
+  // Allocations bigger than a chunk get a chunk of their own.
+  char* big = static_cast<char*>(arena.Allocate(1 << 20, 1));
+  big[(1 << 20) - 1] = 'x';
+  EXPECT_EQ(arena.num_chunks(), 2);
+}
+
+TEST(ArenaTest, ChunksGrow) {
+  Arena arena;
+  vector<int*> ints;
+  for (int i = 0; i < 100000; i++) ints.push_back(arena.New<int>(i));
+  for (int i = 0; i < 100000; i++) EXPECT_EQ(*ints[i], i);
+
+  // 400KB in chunks that double from 256 bytes up to 64KB.
+  EXPECT_LE(arena.num_chunks(), 16);
+}
+
+TEST(ArenaTest, Destructors) {
+  vector<int> destroyed;
+  struct Object {
+    vector<int>* destroyed;
+    int id;
+    ~Object() { destroyed->push_back(id); }
+  };
+
+  {
+    Arena arena;
+    for (int i = 0; i < 3; i++) arena.New<Object>(Object{&destroyed, i});
+    destroyed.clear();  // Of the temporaries.
+  }
+  EXPECT_EQ(destroyed, vector<int>({2, 1, 0}));
+}
+
+TEST(ArenaTest, Adopt) {
+  vector<int> destroyed;
+  struct Object {
+    vector<int>* destroyed;
+    int id;
+    ~Object() { destroyed->push_back(id); }
+  };
+
+  {
+    Arena arena;
+    int* i = arena.New<int>(1);
+    arena.New<Object>(Object{&destroyed, 0});
+    {
+      Arena other;
+      for (int j = 0; j < 1000; j++) other.New<int>(j);
+      other.New<Object>(Object{&destroyed, 1});
+      size_t num_chunks = arena.num_chunks() + other.num_chunks();
+      arena.Adopt(std::move(other));
+      EXPECT_EQ(arena.num_chunks(), num_chunks);
+      EXPECT_EQ(other.num_chunks(), 0);
+
+      // The emptied arena can still be used.
+      EXPECT_EQ(*other.New<int>(2), 2);
+      destroyed.clear();  // Of the temporaries.
+    }
+    EXPECT_TRUE(destroyed.empty());
+
+    // Allocation carries on in the arena's own last chunk.
+    size_t num_chunks = arena.num_chunks();
+    EXPECT_EQ(*arena.New<int>(3), 3);
+    EXPECT_EQ(arena.num_chunks(), num_chunks);
+    EXPECT_EQ(*i, 1);
+  }
+  EXPECT_EQ(destroyed, vector<int>({1, 0}));
+}
+
+TEST(ArenaTest, MakeShared) {
+  auto arena = make_shared<Arena>();
+  shared_ptr<const string> str = MakeShared<const string>(arena, "foo");
+  shared_ptr<int> i = MakeShared<int>(arena, 42);
+
+  // The pointers share ownership of the arena.
+  arena.reset();
+  EXPECT_EQ(*str, "foo");
+  EXPECT_EQ(*i, 42);
+  EXPECT_EQ(str.use_count(), 2);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+#include "util/buffered_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace util {
+
+BufferedWriter::BufferedWriter(int fd, size_t buffer_size)
+    : fd_(fd), buffer_(new char[buffer_size]), capacity_(buffer_size) {
+  CHECK_GE(fd, 0) << "Invalid file descriptor";
+  CHECK_GT(buffer_size, 0) << "buffer_size must be positive";
+}
+
+BufferedWriter::BufferedWriter(const string& path, size_t buffer_size)
+    : fd_(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+      owns_fd_(true),
+      buffer_(new char[buffer_size]),
+      capacity_(buffer_size) {
+  CHECK_GE(fd_, 0) << "Cannot create " << path << ": " << std::strerror(errno);
+  CHECK_GT(buffer_size, 0) << "buffer_size must be positive";
+}
+
+BufferedWriter::BufferedWriter(std::ostream* out, size_t buffer_size)
+    : stream_(CHECK_NOTNULL(out)),
+      buffer_(new char[buffer_size]),
+      capacity_(buffer_size) {
+  CHECK_GT(buffer_size, 0) << "buffer_size must be positive";
+}
+
+BufferedWriter::~BufferedWriter() {
+  Flush();
+  if (owns_fd_) CHECK_EQ(close(fd_), 0) << std::strerror(errno);
+}
+
+void BufferedWriter::Flush() {
+  if (size_ == 0) return;
+  WriteToSink(buffer_.get(), size_);
+  size_ = 0;
+}
+
+void BufferedWriter::WriteSlow(std::string_view str) {
+  Flush();
+  if (str.size() >= capacity_) {
+    // Copying it into the buffer would only mean more, smaller writes.
+    WriteToSink(str.data(), str.size());
+  } else {
+    std::memcpy(buffer_.get(), str.data(), str.size());
+    size_ = str.size();
+  }
+}
+
+void BufferedWriter::WriteToSink(const char* data, size_t size) {
+  if (stream_ != nullptr) {
+    stream_->write(data, size);
+    return;
+  }
+
+  while (size > 0) {
+    ssize_t written = write(fd_, data, size);
+    if (written < 0 && errno == EINTR) continue;
+    CHECK_GT(written, 0) << "Write failed: " << std::strerror(errno);
+    data += written;
+    size -= written;
+  }
+}
+
+}  // namespace util
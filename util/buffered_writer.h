@@ -0,0 +1,114 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include "util/standard_includes.h"
+
+namespace util {
+
+// Writes text to a file descriptor, an output stream, or a string. Writes to a
+// file descriptor or stream are collected in a fixed-size buffer that is
+// reused for the writer's lifetime, so that many small writes cost about a
+// memcpy each rather than a system call or a trip through iostreams; writes to
+// a string are appended to it directly. Integers are formatted with
+// std::to_chars. The buffer is flushed when it fills up, by Flush(), and on
+// destruction.
+class BufferedWriter {
+ public:
+  static constexpr size_t kDefaultBufferSize = 1 << 16;
+
+  // Writes to the file descriptor 'fd', which is left open; FATALs if a write
+  // fails.
+  explicit BufferedWriter(int fd, size_t buffer_size = kDefaultBufferSize);
+
+  // Creates (or truncates) the file at 'path' and writes to it; FATALs if it
+  // can't be created or written. The file is closed on destruction.
+  explicit BufferedWriter(const string& path,
+                          size_t buffer_size = kDefaultBufferSize);
+
+  // Writes to 'out', which must outlive this object.
+  explicit BufferedWriter(std::ostream* out,
+                          size_t buffer_size = kDefaultBufferSize);
+
+  // Appends to 'out', which must outlive this object.
+  explicit BufferedWriter(string* out) : string_(CHECK_NOTNULL(out)) {}
+
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+  BufferedWriter& operator<<(std::string_view str) {
+    if (string_ != nullptr) {
+      string_->append(str);
+    } else if (str.size() <= capacity_ - size_) {
+      std::memcpy(&buffer_[size_], str.data(), str.size());
+      size_ += str.size();
+    } else {
+      WriteSlow(str);
+    }
+    return *this;
+  }
+
+  BufferedWriter& operator<<(const char* str) {
+    return *this << std::string_view(str);
+  }
+
+  BufferedWriter& operator<<(const string& str) {
+    return *this << std::string_view(str);
+  }
+
+  BufferedWriter& operator<<(char c) {
+    if (string_ != nullptr) {
+      string_->push_back(c);
+    } else {
+      if (size_ == capacity_) Flush();
+      buffer_[size_++] = c;
+    }
+    return *this;
+  }
+
+  // Writes an integer in decimal.
+  template <typename Int, typename = std::enable_if_t<
+                              std::is_integral_v<Int> &&
+                              !std::is_same_v<Int, char> &&
+                              !std::is_same_v<Int, bool>>>
+  BufferedWriter& operator<<(Int value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return *this << std::string_view(digits, result.ptr - digits);
+  }
+
+  // Writes 'count' copies of 'c'.
+  BufferedWriter& Repeat(char c, size_t count) {
+    for (size_t i = 0; i < count; ++i) *this << c;
+    return *this;
+  }
+
+  // Writes out everything that has been buffered.
+  void Flush();
+
+ private:
+  // Writes 'str' when it doesn't fit in the rest of the buffer.
+  void WriteSlow(std::string_view str);
+
+  // Writes 'size' bytes at 'data' straight to the file descriptor or stream.
+  void WriteToSink(const char* data, size_t size);
+
+  // The sink: exactly one of these is set.
+  int fd_ = -1;
+  std::ostream* stream_ = nullptr;
+  string* string_ = nullptr;
+
+  // Whether fd_ was opened by this object and so must be closed by it.
+  bool owns_fd_ = false;
+
+  // The buffer (unused when writing to a string), and how much of it is used.
+  unique_ptr<char[]> buffer_;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace util
@@ -0,0 +1,123 @@
+// Tests for the buffered writer.
+
+#include "buffered_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+
+using namespace util;
+
+// Returns the name of a new temporary file.
+string TempFileName() {
+  return std::filesystem::temp_directory_path() /
+         ("buffered_writer_test." + std::to_string(std::rand()));
+}
+
+// Returns the contents of the file at 'filename'.
+string ReadFile(const string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  return string(std::istreambuf_iterator<char>{in}, {});
+}
+
+TEST(BufferedWriterTest, String) {
+  string out = "x";
+  BufferedWriter writer(&out);
+  writer << "ab" << 'c' << string("de") << std::string_view("f");
+  EXPECT_EQ(out, "xabcdef");
+}
+
+TEST(BufferedWriterTest, Integers) {
+  string out;
+  BufferedWriter writer(&out);
+  writer << 0 << ' ' << -42 << ' ' << INT_MIN << ' ' << LLONG_MAX << ' '
+         << size_t{7};
+  EXPECT_EQ(out, "0 -42 -2147483648 9223372036854775807 7");
+}
+
+TEST(BufferedWriterTest, Repeat) {
+  string out;
+  BufferedWriter writer(&out);
+  writer << "int";
+  writer.Repeat('*', 3);
+  writer.Repeat('*', 0);
+  EXPECT_EQ(out, "int***");
+}
+
+// Writes smaller than, equal to, and larger than the buffer must all come out
+// in order.
+TEST(BufferedWriterTest, Stream) {
+  std::ostringstream out;
+  string expected;
+  {
+    BufferedWriter writer(&out, /*buffer_size=*/4);
+    for (const char* str : {"a", "bcd", "efgh", "ijklmnopq", "r", ""}) {
+      writer << str;
+      expected += str;
+    }
+    writer << 12345;
+    expected += "12345";
+  }
+  EXPECT_EQ(out.str(), expected);
+}
+
+TEST(BufferedWriterTest, Flush) {
+  std::ostringstream out;
+  BufferedWriter writer(&out);
+  writer << "abc";
+  EXPECT_EQ(out.str(), "");
+  writer.Flush();
+  EXPECT_EQ(out.str(), "abc");
+}
+
+TEST(BufferedWriterTest, FileDescriptor) {
+  string filename = TempFileName();
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+
+  string expected;
+  {
+    BufferedWriter writer(fd, /*buffer_size=*/16);
+    for (int i = 0; i < 1000; ++i) {
+      writer << "line " << i << '\n';
+      expected += "line " + std::to_string(i) + "\n";
+    }
+  }
+  close(fd);
+  EXPECT_EQ(ReadFile(filename), expected);
+
+  std::filesystem::remove(filename);
+}
+
+TEST(BufferedWriterTest, Path) {
+  string filename = TempFileName();
+  {
+    std::ofstream out(filename);
+    out << "old contents that should be truncated";
+  }
+
+  { BufferedWriter(filename) << "new"; }
+  EXPECT_EQ(ReadFile(filename), "new");
+
+  std::filesystem::remove(filename);
+}
+
+TEST(BufferedWriterDeathTest, UncreatableFile) {
+  EXPECT_DEATH(BufferedWriter("/nonexistent/file.ir"), "Cannot create");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
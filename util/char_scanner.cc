@@ -0,0 +1,164 @@
+#include "util/char_scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTIL_CHAR_SCANNER_X86 1
+#endif
+
+namespace util {
+
+namespace {  // Per-mode implementations of CharScanner::Find().
+
+// Returns the first position at or after 'pos' whose membership in 'member'
+// equals 'in_set'.
+size_t FindScalar(const bool* member, bool in_set, const char* data,
+                  size_t size, size_t pos) {
+  while (pos < size && member[static_cast<unsigned char>(data[pos])] != in_set)
+    pos++;
+  return pos;
+}
+
+#ifdef UTIL_CHAR_SCANNER_X86
+
+__attribute__((target("sse4.2"))) size_t FindSse42(
+    const char* chars, int num_chars, const bool* member, bool in_set,
+    const char* data, size_t size, size_t pos) {
+  const __m128i needle =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+
+  // Never read past the end of the input; the tail is handled below.
+  while (pos + 16 <= size) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    int idx =
+        in_set ? _mm_cmpestri(needle, num_chars, block, 16,
+                              _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                                  _SIDD_LEAST_SIGNIFICANT)
+               : _mm_cmpestri(needle, num_chars, block, 16,
+                              _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                                  _SIDD_NEGATIVE_POLARITY |
+                                  _SIDD_LEAST_SIGNIFICANT);
+    if (idx < 16) return pos + idx;
+    pos += 16;
+  }
+
+  return FindScalar(member, in_set, data, size, pos);
+}
+
+__attribute__((target("avx2"))) size_t FindAvx2(const uint8_t* lo_nibble,
+                                                const uint8_t* hi_nibble,
+                                                const bool* member,
+                                                bool in_set, const char* data,
+                                                size_t size, size_t pos) {
+  const __m256i lo_lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo_nibble)));
+  const __m256i hi_lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi_nibble)));
+  const __m256i low_bits = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+
+  // Never read past the end of the input; the tail is handled below.
+  while (pos + 32 <= size) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    __m256i lo = _mm256_and_si256(block, low_bits);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), low_bits);
+    __m256i hits = _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, lo),
+                                    _mm256_shuffle_epi8(hi_lut, hi));
+
+    // Bit i of 'outside' is set iff byte i is not in the set.
+    uint32_t outside = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, zero)));
+    uint32_t found = in_set ? ~outside : outside;
+    if (found != 0) return pos + __builtin_ctz(found);
+    pos += 32;
+  }
+
+  return FindScalar(member, in_set, data, size, pos);
+}
+
+#endif  // UTIL_CHAR_SCANNER_X86
+
+}  // namespace
+
+void CharScanner::ByteSet::Insert(char c) {
+  unsigned char byte = Byte(c);
+  if (member[byte]) return;
+  member[byte] = true;
+
+  if (byte == 0 || num_chars == 16) {
+    sse_ok = false;
+  } else {
+    chars[num_chars++] = c;
+  }
+
+  if (byte >= 0x80) {
+    avx_ok = false;
+  } else {
+    lo_nibble[byte & 0xf] |= 1 << (byte >> 4);
+    hi_nibble[byte >> 4] = 1 << (byte >> 4);
+  }
+}
+
+CharScanner::CharScanner(const set<char>& whitespace,
+                         const set<char>& delimiter_starts,
+                         optional<Mode> mode) {
+  for (char c : whitespace) {
+    space_.Insert(c);
+    special_.Insert(c);
+    is_space_[Byte(c)] = true;
+  }
+  for (char c : delimiter_starts) special_.Insert(c);
+
+  mode_ = std::min(mode.value_or(kAvx2), BestAvailableMode());
+  if (mode_ == kAvx2 && !(space_.avx_ok && special_.avx_ok)) mode_ = kSse42;
+  if (mode_ == kSse42 && !(space_.sse_ok && special_.sse_ok)) mode_ = kScalar;
+}
+
+CharScanner::Mode CharScanner::BestAvailableMode() {
+#ifdef UTIL_CHAR_SCANNER_X86
+  static const Mode best = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return kAvx2;
+    if (__builtin_cpu_supports("sse4.2")) return kSse42;
+    return kScalar;
+  }();
+  return best;
+#else
+  return kScalar;
+#endif
+}
+
+size_t CharScanner::SkipWhitespace(std::string_view input, size_t pos) const {
+  return Find(space_, false, input, pos);
+}
+
+size_t CharScanner::FindSpecial(std::string_view input, size_t pos) const {
+  return Find(special_, true, input, pos);
+}
+
+size_t CharScanner::Find(const ByteSet& chars, bool in_set,
+                         std::string_view input, size_t pos) const {
+  // Most runs are short, so check the first byte before setting up any vector
+  // registers.
+  if (pos >= input.size()) return input.size();
+  if (chars.member[Byte(input[pos])] == in_set) return pos;
+
+  switch (mode_) {
+#ifdef UTIL_CHAR_SCANNER_X86
+    case kAvx2:
+      return FindAvx2(chars.lo_nibble, chars.hi_nibble, chars.member, in_set,
+                      input.data(), input.size(), pos + 1);
+
+    case kSse42:
+      return FindSse42(chars.chars, chars.num_chars, chars.member, in_set,
+                       input.data(), input.size(), pos + 1);
+#endif
+
+    default:
+      return FindScalar(chars.member, in_set, input.data(), input.size(),
+                        pos + 1);
+  }
+}
+
+}  // namespace util
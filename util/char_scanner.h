@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string_view>
+
+#include "util/standard_includes.h"
+
+namespace util {
+
+// Finds runs of characters for a lexer: given the set of whitespace characters
+// and the set of characters that can start a delimiter, it can skip over
+// whitespace and find the end of an identifier (i.e., the next whitespace or
+// possible delimiter) many bytes at a time.
+//
+// On x86 processors that support them the scanner classifies 16 (SSE4.2) or 32
+// (AVX2) bytes per step; otherwise (or if the character sets can't be handled
+// by those instructions) it falls back to a table lookup per byte. All modes
+// give identical results.
+class CharScanner {
+ public:
+  enum Mode { kScalar, kSse42, kAvx2 };
+
+  // Uses the best mode supported by both the processor and the given character
+  // sets, unless 'mode' says otherwise (in which case the requested mode is
+  // still downgraded if it isn't supported).
+  CharScanner(const set<char>& whitespace, const set<char>& delimiter_starts,
+              optional<Mode> mode = nullopt);
+
+  // Returns the position of the first character at or after 'pos' that is not
+  // whitespace, or input.size() if there is none.
+  size_t SkipWhitespace(std::string_view input, size_t pos) const;
+
+  // Returns the position of the first character at or after 'pos' that is
+  // whitespace or can start a delimiter, or input.size() if there is none.
+  size_t FindSpecial(std::string_view input, size_t pos) const;
+
+  // Returns whether 'c' is whitespace.
+  bool IsSpace(char c) const { return is_space_[Byte(c)]; }
+
+  // The mode actually being used.
+  Mode mode() const { return mode_; }
+
+  // Returns the best mode that the current processor supports.
+  static Mode BestAvailableMode();
+
+ private:
+  // The same set of characters represented in the different ways needed by the
+  // different modes.
+  struct ByteSet {
+    // Scalar: member[c] is whether 'c' is in the set.
+    bool member[256] = {};
+
+    // SSE4.2: the characters in the set (only usable if there are at most 16
+    // and none of them is '\0').
+    char chars[16] = {};
+    int num_chars = 0;
+    bool sse_ok = true;
+
+    // AVX2: 'c' is in the set iff (lo_nibble[c & 0xf] & hi_nibble[c >> 4]) is
+    // non-zero (only usable if the set is all ASCII).
+    uint8_t lo_nibble[16] = {};
+    uint8_t hi_nibble[16] = {};
+    bool avx_ok = true;
+
+    void Insert(char c);
+  };
+
+  static unsigned char Byte(char c) { return static_cast<unsigned char>(c); }
+
+  // Returns the position of the first character at or after 'pos' that is (if
+  // 'in_set') or isn't (if !'in_set') in 'chars'.
+  size_t Find(const ByteSet& chars, bool in_set, std::string_view input,
+              size_t pos) const;
+
+  ByteSet space_, special_;
+  bool is_space_[256] = {};
+  Mode mode_;
+};
+
+}  // namespace util
@@ -0,0 +1,96 @@
+// Tests for the character scanner implementation.
+
+#include "char_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+
+using namespace util;
+
+const set<char> kWhitespace{' ', '\n'};
+const set<char> kDelimiterStarts{':', ',', '=', '-', '*', '[',
+                                 ']', '{', '}', '(', ')'};
+
+vector<CharScanner::Mode> AllModes() {
+  return {CharScanner::kScalar, CharScanner::kSse42, CharScanner::kAvx2};
+}
+
+TEST(CharScannerTest, Basic) {
+  for (auto mode : AllModes()) {
+    CharScanner scanner(kWhitespace, kDelimiterStarts, mode);
+    string input = "foo:int* = $copy   \n  42";
+
+    EXPECT_EQ(scanner.FindSpecial(input, 0), 3);
+    EXPECT_EQ(scanner.FindSpecial(input, 3), 3);
+    EXPECT_EQ(scanner.FindSpecial(input, 4), 7);
+    EXPECT_EQ(scanner.SkipWhitespace(input, 8), 9);
+    EXPECT_EQ(scanner.SkipWhitespace(input, 17), 22);
+    EXPECT_EQ(scanner.FindSpecial(input, 22), input.size());
+    EXPECT_EQ(scanner.SkipWhitespace(input, input.size()), input.size());
+  }
+}
+
+// Runs longer than a vector register, and runs ending in the scalar tail.
+TEST(CharScannerTest, LongRuns) {
+  for (auto mode : AllModes()) {
+    CharScanner scanner(kWhitespace, kDelimiterStarts, mode);
+    for (int length = 0; length < 100; length++) {
+      string ident(length, 'x');
+      EXPECT_EQ(scanner.FindSpecial(ident + ":" + ident, 0), length);
+      EXPECT_EQ(scanner.FindSpecial(ident, 0), length);
+
+      string space(length, ' ');
+      EXPECT_EQ(scanner.SkipWhitespace(space + "x" + space, 0), length);
+      EXPECT_EQ(scanner.SkipWhitespace(space, 0), length);
+    }
+  }
+}
+
+// All modes agree with the scalar mode on random input.
+TEST(CharScannerTest, ModesAgree) {
+  std::mt19937 rng(260);
+  const string alphabet = "abc_@$.0123456789 \n:,=-*[]{}()\t\xff";
+  string input;
+  for (int i = 0; i < 10000; i++) {
+    input.push_back(alphabet[rng() % alphabet.size()]);
+  }
+
+  CharScanner scalar(kWhitespace, kDelimiterStarts, CharScanner::kScalar);
+  for (auto mode : AllModes()) {
+    CharScanner scanner(kWhitespace, kDelimiterStarts, mode);
+    for (size_t pos = 0; pos <= input.size(); pos++) {
+      ASSERT_EQ(scanner.FindSpecial(input, pos), scalar.FindSpecial(input, pos))
+          << "mode " << mode << " pos " << pos;
+      ASSERT_EQ(scanner.SkipWhitespace(input, pos),
+                scalar.SkipWhitespace(input, pos))
+          << "mode " << mode << " pos " << pos;
+    }
+  }
+}
+
+// Character sets that the vector instructions can't represent fall back to
+// a mode that can.
+TEST(CharScannerTest, Downgrade) {
+  EXPECT_EQ(CharScanner({' '}, {'\xe2'}, CharScanner::kAvx2).mode() ==
+                CharScanner::kAvx2,
+            false);
+
+  set<char> many;
+  for (char c = 'a'; c <= 'z'; c++) many.insert(c);
+  EXPECT_EQ(CharScanner({' '}, many, CharScanner::kSse42).mode(),
+            CharScanner::kScalar);
+  EXPECT_EQ(CharScanner({' '}, many, CharScanner::kScalar).mode(),
+            CharScanner::kScalar);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
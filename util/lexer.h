@@ -0,0 +1,475 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include "util/char_scanner.h"
+#include "util/standard_includes.h"
+
+namespace util {
+
+// A compiled description of what a Lexer should consider whitespace,
+// delimiters, reserved words, and raw delimiters (with exactly the meanings
+// described for Tokenizer). Building a spec does all the preprocessing needed
+// for lexing, so a spec that is built once and shared by many Lexers makes
+// lexing many small inputs cheap. A spec is immutable once built, so it can be
+// shared between threads.
+class LexerSpec {
+ public:
+  LexerSpec(const set<char>& whitespace, const set<string>& delimiters,
+            const set<string>& reserved_words,
+            const optional<std::pair<string, string>>& raw = nullopt,
+            optional<CharScanner::Mode> mode = nullopt)
+      : raw_(raw), scanner_({}, {}) {
+    // '\n' is always considered a delimiter (but if it is also whitespace it
+    // is skipped by the scanner before ever being matched as one).
+    AddDelimiter("\n");
+    for (const auto& delimit : delimiters) AddDelimiter(delimit);
+
+    // Treat the raw delimiters also as regular delimiters.
+    if (raw) {
+      AddDelimiter(raw->first);
+      AddDelimiter(raw->second);
+    }
+
+    set<char> delimiter_starts;
+    for (int c = 0; c < 256; c++) {
+      if (!delimiters_[c].empty()) delimiter_starts.insert(c);
+    }
+    scanner_ = CharScanner(whitespace, delimiter_starts, mode);
+
+    BuildReservedWordTable(reserved_words);
+  }
+
+  // Returns a copy of this spec that scans using the given mode (e.g., to
+  // compare the different modes); the actual mode may be downgraded by the
+  // CharScanner.
+  LexerSpec WithScanMode(CharScanner::Mode mode) const {
+    LexerSpec spec(*this);
+    set<char> whitespace, delimiter_starts;
+    for (int c = 0; c < 256; c++) {
+      if (scanner_.IsSpace(c)) whitespace.insert(c);
+      if (!delimiters_[c].empty()) delimiter_starts.insert(c);
+    }
+    spec.scanner_ = CharScanner(whitespace, delimiter_starts, mode);
+    return spec;
+  }
+
+  const CharScanner& scanner() const { return scanner_; }
+  const optional<std::pair<string, string>>& raw() const { return raw_; }
+
+  // Returns the length of the delimiter starting at input[pos], or 0 if no
+  // delimiter starts there. If one delimiter is a prefix of another, the longer
+  // one is matched.
+  size_t MatchDelimiter(std::string_view input, size_t pos) const {
+    for (const auto& delimit : delimiters_[Byte(input[pos])]) {
+      if (input.compare(pos, delimit.size(), delimit) == 0) {
+        return delimit.size();
+      }
+    }
+    return 0;
+  }
+
+  bool IsDelimiter(std::string_view token) const {
+    if (token.empty()) return false;
+    const auto& candidates = delimiters_[Byte(token[0])];
+    return std::find(candidates.begin(), candidates.end(), token) !=
+           candidates.end();
+  }
+
+  // Returns the index of 'token' among the reserved words (in sorted order),
+  // or -1 if it isn't a reserved word.
+  int ReservedWordIndex(std::string_view token) const {
+    if (reserved_table_.empty()) return -1;
+    int index =
+        reserved_table_[Hash(token, seed_) & (reserved_table_.size() - 1)];
+    return (index >= 0 && reserved_words_[index] == token) ? index : -1;
+  }
+
+  bool IsReservedWord(std::string_view token) const {
+    return ReservedWordIndex(token) >= 0;
+  }
+
+ private:
+  static unsigned char Byte(char c) { return static_cast<unsigned char>(c); }
+
+  // FNV-1a, mixed with a seed.
+  static uint64_t Hash(std::string_view str, uint64_t seed) {
+    uint64_t hash = 0xcbf29ce484222325 ^ (seed * 0x9e3779b97f4a7c15);
+    for (char c : str) {
+      hash ^= Byte(c);
+      hash *= 0x100000001b3;
+    }
+    return hash ^ (hash >> 29);
+  }
+
+  void AddDelimiter(const string& delimit) {
+    CHECK_NE(delimit, "") << "Empty delimiter";
+    auto& candidates = delimiters_[Byte(delimit[0])];
+    if (std::find(candidates.begin(), candidates.end(), delimit) !=
+        candidates.end()) {
+      return;
+    }
+
+    // Keep candidates sorted longest first, so that if delimiter A is a prefix
+    // of delimiter B then B is matched before A is.
+    candidates.push_back(delimit);
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const string& s1, const string& s2) {
+                       return s1.size() > s2.size();
+                     });
+  }
+
+  // Builds a perfect hash table for the reserved words: we search for a seed
+  // under which no two reserved words hash to the same slot, so that a lookup
+  // costs one hash and at most one string comparison.
+  void BuildReservedWordTable(const set<string>& reserved_words) {
+    reserved_words_.assign(reserved_words.begin(), reserved_words.end());
+    if (reserved_words_.empty()) return;
+
+    size_t size = 1;
+    while (size < 2 * reserved_words_.size()) size *= 2;
+
+    for (seed_ = 0;; seed_++) {
+      // Grow the table every so often if no seed is working out.
+      if (seed_ > 0 && seed_ % 64 == 0) size *= 2;
+
+      reserved_table_.assign(size, -1);
+      bool collision = false;
+      for (size_t i = 0; i < reserved_words_.size() && !collision; i++) {
+        int& slot =
+            reserved_table_[Hash(reserved_words_[i], seed_) & (size - 1)];
+        collision = slot != -1;
+        slot = i;
+      }
+      if (!collision) return;
+    }
+  }
+
+  // delimiters_[c] is the list of delimiters starting with 'c', longest first.
+  vector<string> delimiters_[256];
+
+  // The reserved words, and the perfect hash table mapping Hash(word, seed_)
+  // (modulo the table size, a power of two) to the word's index (or -1).
+  vector<string> reserved_words_;
+  vector<int> reserved_table_;
+  uint64_t seed_ = 0;
+
+  optional<std::pair<string, string>> raw_;
+
+  // Classifies whitespace and characters that can start a delimiter.
+  CharScanner scanner_;
+};
+
+// A streaming alternative to Tokenizer with the same parsing contract. Instead
+// of tokenizing the whole input up front into copied strings, a Lexer scans the
+// input lazily and hands out tokens as string_views into the input buffer,
+// keeping only a small ring of lookahead tokens. Runs of whitespace and
+// identifier characters are skipped many bytes at a time (see CharScanner).
+//
+// The input is NOT copied: the caller must keep the buffer alive (and
+// unchanged) for as long as the Lexer is in use. Returned tokens remain valid
+// for as long as the input buffer does.
+class Lexer {
+ public:
+  // The maximum number of tokens that can be looked ahead at (so the largest
+  // allowed argument to Peek() is kMaxLookahead - 1).
+  static constexpr int kMaxLookahead = 16;
+
+  // The maximum number of tokens that may be put back (see Put()) and not yet
+  // consumed; the IR parser never needs more than the two tokens it peeks at.
+  static constexpr int kMaxPutBack = 2;
+
+  // Called with the message for each syntax error; must not return (e.g., it
+  // may throw an exception).
+  using ErrorHandler = std::function<void(const string& message)>;
+
+  // Lexes 'input' according to a shared, precompiled spec. If 'input' is part
+  // of a larger text, 'first_line' is the line of that text on which 'input'
+  // starts (so that error messages have the right line numbers).
+  Lexer(std::string_view input, shared_ptr<const LexerSpec> spec,
+        int first_line = 1)
+      : input_(input),
+        scan_line_(first_line),
+        line_number_(first_line),
+        spec_(std::move(spec)) {
+    CHECK(spec_ != nullptr) << "Lexer spec must be non-null";
+  }
+
+  // Lexes 'input' according to a spec built just for this Lexer; the arguments
+  // are as for LexerSpec.
+  Lexer(std::string_view input, const set<char>& whitespace,
+        const set<string>& delimiters, const set<string>& reserved_words,
+        const optional<std::pair<string, string>>& raw = nullopt)
+      : Lexer(input, make_shared<LexerSpec>(whitespace, delimiters,
+                                            reserved_words, raw)) {}
+
+  // Confirms that the next token is 'str' and consumes it; FATALs if the next
+  // token is not 'str'.
+  void Consume(std::string_view str) {
+    std::string_view token = ConsumeNextToken();
+    if (token != str) Error("unexpected token "s + string(token));
+  }
+
+  // Returns whether the next token is 'str' and consumes it if so.
+  bool QueryConsume(std::string_view str) {
+    if (ReturnNextToken() == str && num_tokens_ > 0) {
+      ConsumeNextToken();
+      return true;
+    }
+    return false;
+  }
+
+  // Returns whether the next token is 'str'; doesn't consume it either way.
+  bool QueryNoConsume(std::string_view str) { return ReturnNextToken() == str; }
+
+  // Consumes and returns the next token; FATALs if that token is a delimiter or
+  // reserved word or if we're at the end of the input.
+  std::string_view ConsumeToken() {
+    std::string_view token = ConsumeNextToken();
+    if (spec_->IsDelimiter(token) || spec_->IsReservedWord(token)) {
+      Error("read delimiter or reserved word: "s + string(token));
+    }
+    return token;
+  }
+
+  // Acts like ConsumeToken() except that it doesn't check the contents of the
+  // token against delimiters or reserved words. Line numbers are tracked
+  // correctly even if the raw token contains one or more newlines.
+  std::string_view ConsumeRaw() {
+    Fill(1);
+    if (num_tokens_ == 0) Error("unexpected end of input");
+    return Pop();
+  }
+
+  // Consumes and returns the next character; FATALS if that token is a
+  // delimiter or reserved word or if we're at the end of the input.
+  char ConsumeChar() {
+    std::string_view token = ReturnNextToken();
+    if (token.empty()) Error("unexpected end of input");
+
+    char retval = token[0];
+    if (spec_->IsDelimiter(token.substr(0, 1)) ||
+        spec_->IsReservedWord(token.substr(0, 1))) {
+      Error("read delimiter or reserved word: "s + string(token));
+    }
+
+    // The rest of the token (if any) stays at the front of the stream.
+    Front().text.remove_prefix(1);
+    if (Front().text.empty()) Pop();
+
+    return retval;
+  }
+
+  // Returns whether the next token is reserved or a delimiter.
+  bool IsNextReserved() {
+    auto token = Peek(0);
+    return spec_->IsDelimiter(token) || spec_->IsReservedWord(token);
+  }
+
+  // Put a token onto the token stream; it will be the next token to be read.
+  // The token is copied into the ring, so it need not outlive the call (but
+  // the view returned when it is consumed is only valid until the next call
+  // to Put()).
+  void Put(std::string_view token) {
+    ReturnNextToken();
+    CHECK_LT(num_put_, kMaxPutBack) << "too many tokens put back";
+    CHECK_LT(num_tokens_, kRingSize) << "too many tokens buffered";
+    head_ = (head_ + kRingSize - 1) % kRingSize;
+    num_tokens_++;
+    num_put_++;
+    string& text = put_text_[head_];
+    text.assign(token);
+    Front() = {text, line_number_, true};
+  }
+
+  // Return the token in 'ahead' position from the beginning of the stream
+  // (starting with 0). If 'ahead' exceeds the number of remaining tokens
+  // returns the empty string.
+  std::string_view Peek(int ahead) {
+    CHECK_LT(ahead, kMaxLookahead) << "cannot look that far ahead";
+    ReturnNextToken();
+    Fill(ahead + 1);
+    if (ahead >= num_tokens_) return "";
+    return At(ahead).text;
+  }
+
+  // Returns whether we've reached the end of the input or not.
+  bool EndOfInput() { return ReturnNextToken().empty(); }
+
+  // Returns the line number of the next token (or of the end of the input).
+  int line_number() {
+    ReturnNextToken();
+    return line_number_;
+  }
+
+  // Overrides how runs of characters are scanned (e.g., to compare the
+  // different modes); the actual mode may be downgraded by the CharScanner.
+  void SetScanMode(CharScanner::Mode mode) {
+    spec_ = make_shared<LexerSpec>(spec_->WithScanMode(mode));
+  }
+
+  // The mode being used to scan runs of characters.
+  CharScanner::Mode scan_mode() const { return spec_->scanner().mode(); }
+
+  // Reports syntax errors to 'handler' instead of FATALing.
+  void SetErrorHandler(ErrorHandler handler) {
+    error_handler_ = std::move(handler);
+  }
+
+  // Reports a syntax error on the current line, either to the error handler or
+  // by FATALing. Parsers using the Lexer can report their own errors this way.
+  [[noreturn]] void Error(const string& err) {
+    string message =
+        "Syntax error on line " + std::to_string(line_number_) + ": " + err;
+    if (error_handler_) error_handler_(message);
+    LOG(FATAL) << message;
+    std::abort();  // Not reached.
+  }
+
+ private:
+  // A scanned token and the line on which it starts.
+  struct Token {
+    std::string_view text;
+    int line;
+    // Whether the text is in put_text_ (see Put()).
+    bool put = false;
+  };
+
+  // The token 'ahead' positions from the front of the stream.
+  Token& At(int ahead) { return ring_[(head_ + ahead) % kRingSize]; }
+  Token& Front() { return ring_[head_]; }
+
+  void PushBack(std::string_view text, int line) {
+    CHECK_LT(num_tokens_, kRingSize) << "too many tokens buffered";
+    At(num_tokens_++) = {text, line};
+  }
+
+  // Scans the next token(s) from the input and appends them to ring_. Returns
+  // false if there are no more tokens.
+  bool ScanToken() {
+    const CharScanner& scanner = spec_->scanner();
+
+    // Skip whitespace, counting any newlines that are considered whitespace.
+    size_t start = scanner.SkipWhitespace(input_, pos_);
+    if (scanner.IsSpace('\n')) {
+      scan_line_ +=
+          std::count(input_.begin() + pos_, input_.begin() + start, '\n');
+    }
+    pos_ = start;
+    if (pos_ == input_.size()) return false;
+
+    int line = scan_line_;
+
+    if (size_t length = spec_->MatchDelimiter(input_, pos_); length != 0) {
+      pos_ += length;
+      if (input_[start] == '\n') scan_line_++;
+
+      // Everything between the raw delimiters is a single token (which starts
+      // immediately after the left raw delimiter, even if with whitespace).
+      // The left delimiter, raw token, and right delimiter are all scanned
+      // together so that the right delimiter is never mistaken for a left one.
+      const auto& raw = spec_->raw();
+      if (raw && input_.substr(start, length) == raw->first) {
+        size_t end = input_.find(raw->second, pos_);
+        if (end == std::string_view::npos) {
+          line_number_ = line;
+          Error("left raw delimiter unmatched by right raw delimiter");
+        }
+        PushBack(input_.substr(start, length), line);
+        PushBack(input_.substr(pos_, end - pos_), scan_line_);
+        scan_line_ +=
+            std::count(input_.begin() + pos_, input_.begin() + end, '\n');
+        start = end;
+        line = scan_line_;
+        pos_ = end + raw->second.size();
+      }
+    } else {
+      // A regular token extends until whitespace or the next delimiter. Skip
+      // over characters that can start a delimiter but don't here (e.g., the
+      // '-' of a negative number when "->" is a delimiter).
+      pos_ = scanner.FindSpecial(input_, pos_);
+      while (pos_ < input_.size() && !scanner.IsSpace(input_[pos_]) &&
+             spec_->MatchDelimiter(input_, pos_) == 0) {
+        pos_ = scanner.FindSpecial(input_, pos_ + 1);
+      }
+    }
+
+    PushBack(input_.substr(start, pos_ - start), line);
+    return true;
+  }
+
+  // Makes sure that at least 'count' tokens are buffered (if the input has
+  // that many tokens left).
+  void Fill(int count) {
+    while (num_tokens_ < count && ScanToken()) {
+    }
+  }
+
+  // Returns the next token without consuming it; returns the empty string if
+  // we're at the end of the input.
+  std::string_view ReturnNextToken() {
+    Fill(1);
+    if (num_tokens_ == 0) {
+      line_number_ = scan_line_;
+      return "";
+    }
+    line_number_ = Front().line;
+    return Front().text;
+  }
+
+  // Consumes and returns the next token; FATALs if we're at the end of the
+  // input.
+  std::string_view ConsumeNextToken() {
+    ReturnNextToken();
+    if (num_tokens_ == 0) Error("unexpected end of input");
+    return Pop();
+  }
+
+  // Removes the next token from the ring and returns it, advancing the line
+  // number past any newlines it contains.
+  std::string_view Pop() {
+    Token token = Front();
+    head_ = (head_ + 1) % kRingSize;
+    num_tokens_--;
+    if (token.put) num_put_--;
+    line_number_ =
+        token.line + std::count(token.text.begin(), token.text.end(), '\n');
+    return token.text;
+  }
+
+  // The input being scanned and the position of the next unscanned character.
+  std::string_view input_;
+  size_t pos_ = 0;
+
+  // The line number at pos_.
+  int scan_line_;
+
+  // The current line number within the input being parsed.
+  int line_number_;
+
+  // The number of slots in ring_. Fill() only scans while fewer than
+  // kMaxLookahead tokens are buffered, but a raw token is scanned together
+  // with its delimiters (up to two more tokens than asked for), and up to
+  // kMaxPutBack tokens may be put back in front of a full lookahead.
+  static constexpr int kRingSize = kMaxLookahead + 2 + kMaxPutBack;
+
+  // Scanned but not yet consumed tokens: a ring buffer holding 'num_tokens_'
+  // tokens starting at index 'head_' (the front of the stream).
+  std::array<Token, kRingSize> ring_;
+  int head_ = 0;
+  int num_tokens_ = 0;
+
+  // Storage for tokens given to Put(): put_text_[i] holds the text of ring_[i]
+  // if it was put back. The strings keep their capacity, so putting back short
+  // tokens doesn't allocate once the ring has warmed up.
+  std::array<string, kRingSize> put_text_;
+  int num_put_ = 0;
+
+  shared_ptr<const LexerSpec> spec_;
+
+  // If set, receives syntax errors (see SetErrorHandler()).
+  ErrorHandler error_handler_;
+};
+
+}  // namespace util
@@ -0,0 +1,96 @@
+// Compares the Tokenizer against the Lexer (in each of its scan modes) on
+// large generated IR-like inputs.
+
+#include <benchmark/benchmark.h>
+
+#include "util/lexer.h"
+#include "util/tokenizer.h"
+
+namespace {
+
+using namespace util;
+
+const set<char> kWhitespace{' ', '\n'};
+const set<string> kDelimiters{":", ",", "=", "->", "*", "[",
+                              "]", "{", "}", "(",  ")"};
+const set<string> kReserved{"$arith", "$cmp",   "$phi",    "$alloc", "$addrof",
+                            "$load",  "$store", "$gep",    "$select", "$call",
+                            "$icall", "$ret",   "$jump",   "$branch"};
+
+// Returns an IR-like input with roughly 'num_functions' * 1KB of text.
+string MakeInput(int num_functions) {
+  string input;
+  for (int i = 0; i < num_functions; i++) {
+    string f = std::to_string(i);
+    input += "function func" + f + "(param_a:int*, param_b:node_t*) -> int {\n";
+    input += "entry:\n";
+    input += "  tmp" + f + ":int = $load param_a:int*\n";
+    input += "  sum" + f + ":int = $arith add tmp" + f + ":int -1\n";
+    input += "  fld" + f + ":node_t** = $gep param_b:node_t* 0 next_node\n";
+    input += "  res" + f + ":int = $call func" + f + "(sum" + f + ":int)\n";
+    input += "  fp:int[int]* = $copy @func" + f + ":int[int]*\n";
+    input += "  cmp" + f + ":int = $cmp lt res" + f + ":int 1000\n";
+    input += "  $branch cmp" + f + ":int loop.body exit\n\n";
+    input += "loop.body:\n";
+    input += "  $store param_a:int* res" + f + ":int\n";
+    input += "  $jump entry\n\n";
+    input += "exit:\n";
+    input += "  $ret res" + f + ":int\n";
+    input += "}\n\n";
+  }
+  return input;
+}
+
+void BM_Tokenizer(benchmark::State& state) {
+  string input = MakeInput(state.range(0));
+  for (auto _ : state) {
+    Tokenizer tk(input, kWhitespace, kDelimiters, kReserved);
+    while (!tk.EndOfInput()) benchmark::DoNotOptimize(tk.ConsumeRaw());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+void BM_Lexer(benchmark::State& state) {
+  string input = MakeInput(state.range(0));
+  auto mode = static_cast<CharScanner::Mode>(state.range(1));
+  for (auto _ : state) {
+    Lexer lx(input, kWhitespace, kDelimiters, kReserved);
+    lx.SetScanMode(mode);
+    if (lx.scan_mode() != mode) {
+      state.SkipWithError("scan mode not supported");
+      break;
+    }
+    while (!lx.EndOfInput()) benchmark::DoNotOptimize(lx.ConsumeRaw());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+// Lexing many small snippets (e.g., single instructions), either building a
+// spec for each snippet or sharing one precompiled spec.
+void BM_SmallInputs(benchmark::State& state) {
+  const bool shared = state.range(0);
+  const string snippet = "res:int = $call func(sum:int, -1)";
+  auto spec = make_shared<const LexerSpec>(kWhitespace, kDelimiters, kReserved);
+  for (auto _ : state) {
+    if (shared) {
+      Lexer lx(snippet, spec);
+      while (!lx.EndOfInput()) benchmark::DoNotOptimize(lx.ConsumeRaw());
+    } else {
+      Lexer lx(snippet, kWhitespace, kDelimiters, kReserved);
+      while (!lx.EndOfInput()) benchmark::DoNotOptimize(lx.ConsumeRaw());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Tokenizer)->Arg(100)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Lexer)
+    ->ArgsProduct({{100, 10000},
+                   {CharScanner::kScalar, CharScanner::kSse42,
+                    CharScanner::kAvx2}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SmallInputs)->Arg(false)->Arg(true);
+
+}  // namespace
+
+BENCHMARK_MAIN();
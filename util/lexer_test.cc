@@ -0,0 +1,389 @@
+// Tests for the lexer implementation.
+
+#include "lexer.h"
+
+#include <gtest/gtest.h>
+
+#include "tokenizer.h"
+
+namespace {
+
+using namespace util;
+
+TEST(LexerTest, NoWhitespace) {
+  string input = "a aa aaa aaaa";
+  Lexer lx(input, {}, {}, {});
+
+  EXPECT_FALSE(lx.QueryConsume("a"));
+  EXPECT_FALSE(lx.QueryNoConsume("a"));
+  EXPECT_FALSE(lx.EndOfInput());
+  EXPECT_TRUE(lx.QueryNoConsume("a aa aaa aaaa"));
+  EXPECT_TRUE(lx.QueryConsume("a aa aaa aaaa"));
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+TEST(LexerTest, Whitespace) {
+  string input = "a aa aaa aaaa";
+  Lexer lx(input, {' '}, {}, {});
+
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_FALSE(lx.QueryNoConsume("a"));
+  EXPECT_TRUE(lx.QueryNoConsume("aa"));
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("aa"));
+  EXPECT_EQ(lx.ConsumeToken(), "aaa");
+  EXPECT_FALSE(lx.EndOfInput());
+}
+
+TEST(LexerTest, Newlines) {
+  string input = "a \na,a a\naa \na,aa,a";
+  Lexer lx(input, {' '}, {","}, {});
+
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("\n"));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume(","));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("\n"));
+  EXPECT_TRUE(lx.QueryConsume("aa"));
+  EXPECT_TRUE(lx.QueryConsume("\n"));
+  EXPECT_EQ(lx.line_number(), 4);
+}
+
+TEST(LexerTest, ConsumeChar) {
+  string input = "a \na,a a\naa \na,aa,a";
+  Lexer lx(input, {' ', '\n'}, {","}, {});
+
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(","));
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(","));
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(","));
+  EXPECT_EQ(lx.ConsumeChar(), 'a');
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+TEST(LexerTest, LongestDelimiterFirst) {
+  string input = "a->b-1 -> -2--c";
+  Lexer lx(input, {' '}, {"->", "-", "--"}, {});
+
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("->"));
+  EXPECT_EQ(lx.ConsumeToken(), "b");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("-"));
+  EXPECT_EQ(lx.ConsumeToken(), "1");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("->"));
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("-"));
+  EXPECT_EQ(lx.ConsumeToken(), "2");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("--"));
+  EXPECT_EQ(lx.ConsumeToken(), "c");
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+TEST(LexerTest, RawDelimiters) {
+  string input = "a[[a,a\n a]]a , a[[a,,a]] a ,[[\n]] a [[a,a]]a";
+  Lexer lx(input, {' ', '\n'}, {","}, {}, pair<string, string>{"[[", "]]"});
+
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("[["));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,a\n a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]]"));
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(","));
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("[["));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,,a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]]"));
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(","));
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("[["));
+  EXPECT_EQ(lx.ConsumeRaw(), "\n");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]]"));
+  EXPECT_EQ(lx.line_number(), 3);
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("[["));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]]"));
+  EXPECT_EQ(lx.ConsumeToken(), "a");
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+TEST(LexerTest, SameRawDelimiters) {
+  string input = "|a,a\n a||a,,a|";
+  Lexer lx(input, {' ', '\n'}, {","}, {}, pair<string, string>{"|", "|"});
+
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("|"));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,a\n a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("|"));
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("|"));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,,a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("|"));
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+TEST(LexerTest, Reserved) {
+  string input = "reserved notreserved;";
+  Lexer lx(input, {' ', '\n'}, {";"}, {"reserved"});
+
+  EXPECT_TRUE(lx.IsNextReserved());
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("reserved"));
+  EXPECT_FALSE(lx.IsNextReserved());
+  EXPECT_NO_FATAL_FAILURE(lx.ConsumeToken());
+  EXPECT_TRUE(lx.IsNextReserved());
+  EXPECT_NO_FATAL_FAILURE(lx.Consume(";"));
+  EXPECT_FALSE(lx.IsNextReserved());
+}
+
+TEST(LexerTest, PeekAndPut) {
+  string input = "a\nb c\n\nd\n";
+  Lexer lx(input, {' ', '\n'}, {}, {"b", "d"});
+
+  EXPECT_EQ(lx.Peek(0), "a");
+  EXPECT_EQ(lx.Peek(3), "d");
+  EXPECT_EQ(lx.Peek(4), "");
+  EXPECT_EQ(lx.Peek(1), "b");
+
+  lx.Put("e");
+  EXPECT_TRUE(lx.QueryConsume("e"));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("b"));
+  EXPECT_TRUE(lx.QueryConsume("c"));
+  EXPECT_TRUE(lx.QueryConsume("d"));
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+// Put-back tokens live in the lookahead ring, which holds only a few of them.
+TEST(LexerTest, PutBackIsBounded) {
+  string input = "c";
+  Lexer lx(input, {' '}, {}, {});
+
+  for (int i = 0; i < 1000; ++i) {
+    lx.Put("b");
+    lx.Put("a");
+    EXPECT_EQ(lx.Peek(2), "c");
+    EXPECT_EQ(lx.ConsumeToken(), "a");
+    EXPECT_EQ(lx.ConsumeToken(), "b");
+  }
+  EXPECT_EQ(lx.ConsumeToken(), "c");
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+// A raw token is scanned along with both of its delimiters, even when that
+// buffers more tokens than were peeked at.
+TEST(LexerTest, DeepPeekBeforeRaw) {
+  string input;
+  for (int i = 0; i < Lexer::kMaxLookahead - 1; ++i) input += "a ";
+  input += "[[b c]] d";
+  Lexer lx(input, {' '}, {}, {}, pair<string, string>{"[[", "]]"});
+
+  EXPECT_EQ(lx.Peek(Lexer::kMaxLookahead - 1), "[[");
+  lx.Put("y");
+  lx.Put("x");
+  EXPECT_EQ(lx.ConsumeToken(), "x");
+  EXPECT_EQ(lx.ConsumeToken(), "y");
+  for (int i = 0; i < Lexer::kMaxLookahead - 1; ++i) {
+    EXPECT_EQ(lx.ConsumeToken(), "a");
+  }
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("[["));
+  EXPECT_EQ(lx.ConsumeRaw(), "b c");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]]"));
+  EXPECT_EQ(lx.ConsumeToken(), "d");
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+// Tokens are views into the input rather than copies.
+TEST(LexerTest, ZeroCopy) {
+  string input = "foo:int* = $copy 42";
+  Lexer lx(input, {' '}, {":", "*", "="}, {"$copy"});
+
+  auto token = lx.ConsumeToken();
+  EXPECT_EQ(token, "foo");
+  EXPECT_EQ(token.data(), input.data());
+}
+
+// The lexer produces exactly the same token stream as the tokenizer.
+TEST(LexerTest, MatchesTokenizer) {
+  string input = R"""(function foo(p1:int*, p2:int*) -> int {
+entry:
+  x:int = $arith sub p:int -1
+  src:int[int*,int*]* = $copy @foo:int[int*,int*]*
+  $ret 0
+}
+)""";
+  set<char> whitespace{' ', '\n'};
+  set<string> delimiters{":", ",", "=", "->", "*", "[",
+                         "]", "{", "}", "(", ")"};
+
+  Tokenizer tk(input, whitespace, delimiters, {});
+  Lexer lx(input, whitespace, delimiters, {});
+
+  while (!tk.EndOfInput()) {
+    ASSERT_FALSE(lx.EndOfInput());
+    EXPECT_EQ(lx.ConsumeRaw(), tk.ConsumeRaw());
+  }
+  EXPECT_TRUE(lx.EndOfInput());
+}
+
+// One spec can be shared by many lexers.
+TEST(LexerTest, SharedSpec) {
+  auto spec = make_shared<const LexerSpec>(set<char>{' '}, set<string>{","},
+                                           set<string>{"if", "else"});
+  string input1 = "a,if b";
+  string input2 = "else,c";
+  Lexer lx1(input1, spec);
+  Lexer lx2(input2, spec);
+
+  EXPECT_EQ(lx1.ConsumeToken(), "a");
+  EXPECT_TRUE(lx2.IsNextReserved());
+  EXPECT_NO_FATAL_FAILURE(lx2.Consume("else"));
+  EXPECT_NO_FATAL_FAILURE(lx1.Consume(","));
+  EXPECT_TRUE(lx1.IsNextReserved());
+  EXPECT_NO_FATAL_FAILURE(lx2.Consume(","));
+  EXPECT_EQ(lx2.ConsumeToken(), "c");
+  EXPECT_TRUE(lx2.EndOfInput());
+}
+
+TEST(LexerSpecTest, ReservedWords) {
+  set<string> reserved{"$arith", "$cmp",    "$phi",  "$alloc", "$addrof",
+                       "$load",  "$store",  "$gep",  "$select", "$call",
+                       "$icall", "$ret",    "$jump", "$branch"};
+  LexerSpec spec({' '}, {}, reserved);
+
+  int index = 0;
+  for (const auto& word : reserved) {
+    EXPECT_EQ(spec.ReservedWordIndex(word), index++) << word;
+  }
+  for (const char* word : {"", "$", "$ari", "$arithm", "arith", "$Call"}) {
+    EXPECT_FALSE(spec.IsReservedWord(word)) << word;
+  }
+
+  LexerSpec empty({' '}, {}, {});
+  EXPECT_FALSE(empty.IsReservedWord("$arith"));
+}
+
+TEST(LexerSpecTest, Delimiters) {
+  LexerSpec spec({' '}, {"-", "->", ">"}, {});
+  string input = "a->b";
+
+  EXPECT_EQ(spec.MatchDelimiter(input, 0), 0);
+  EXPECT_EQ(spec.MatchDelimiter(input, 1), 2);
+  EXPECT_EQ(spec.MatchDelimiter(input, 2), 1);
+  EXPECT_TRUE(spec.IsDelimiter("->"));
+  EXPECT_TRUE(spec.IsDelimiter("\n"));
+  EXPECT_FALSE(spec.IsDelimiter("-->"));
+}
+
+// Every scan mode produces the same token stream.
+TEST(LexerTest, ScanModes) {
+  string input;
+  for (int i = 0; i < 50; i++) {
+    input += "  a_long_variable_name_" + std::to_string(i) +
+             ":int** = $arith sub    b:int -" + std::to_string(i) + "\n";
+  }
+  set<char> whitespace{' ', '\n'};
+  set<string> delimiters{":", ",", "=", "->", "*", "[",
+                         "]", "{", "}", "(", ")"};
+
+  Lexer scalar(input, whitespace, delimiters, {"$arith"});
+  scalar.SetScanMode(CharScanner::kScalar);
+  EXPECT_EQ(scalar.scan_mode(), CharScanner::kScalar);
+
+  for (auto mode : {CharScanner::kSse42, CharScanner::kAvx2}) {
+    Lexer lx(input, whitespace, delimiters, {"$arith"});
+    lx.SetScanMode(mode);
+    Lexer expected(input, whitespace, delimiters, {"$arith"});
+    expected.SetScanMode(CharScanner::kScalar);
+
+    while (!expected.EndOfInput()) {
+      ASSERT_EQ(lx.line_number(), expected.line_number());
+      ASSERT_EQ(lx.ConsumeRaw(), expected.ConsumeRaw());
+    }
+    EXPECT_TRUE(lx.EndOfInput());
+  }
+}
+
+TEST(LexerDeathTest, BadConsume) {
+  string input = "a aa aaa aaaa";
+  Lexer lx(input, {' '}, {}, {});
+  EXPECT_DEATH(lx.Consume("aa"), "unexpected token");
+}
+
+TEST(LexerDeathTest, ReservedToken) {
+  string input = "a aa aaa aaaa";
+  Lexer lx(input, {' '}, {}, {"aa"});
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_DEATH(lx.ConsumeToken(), "read delimiter or reserved word");
+}
+
+TEST(LexerDeathTest, LineNumbers) {
+  string input = "a \na,a a\naa \na,aa,a";
+  Lexer lx(input, {' ', '\n'}, {","}, {});
+
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume(","));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  EXPECT_TRUE(lx.QueryConsume("aa"));
+  EXPECT_DEATH(lx.Consume("aa"), "line 4");
+}
+
+TEST(LexerDeathTest, TooManyPutBack) {
+  string input = "a";
+  Lexer lx(input, {' '}, {}, {});
+  for (int i = 0; i < Lexer::kMaxPutBack; ++i) lx.Put("b");
+  EXPECT_DEATH(lx.Put("b"), "too many tokens put back");
+}
+
+TEST(LexerDeathTest, UnmatchedRaw) {
+  string input = "[a,a\n a][a,,a";
+  Lexer lx(input, {' ', '\n'}, {","}, {}, pair<string, string>{"[", "]"});
+
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("["));
+  EXPECT_EQ(lx.ConsumeRaw(), "a,a\n a");
+  EXPECT_NO_FATAL_FAILURE(lx.Consume("]"));
+  EXPECT_DEATH(lx.Consume("["), "unmatched");
+}
+
+TEST(LexerTest, ErrorHandler) {
+  struct SyntaxError {
+    string message;
+  };
+
+  string input = "a\n, b";
+  Lexer lx(input, {' ', '\n'}, {","}, {});
+  lx.SetErrorHandler([](const string& message) { throw SyntaxError{message}; });
+
+  EXPECT_TRUE(lx.QueryConsume("a"));
+  try {
+    lx.ConsumeToken();
+    FAIL() << "expected a syntax error";
+  } catch (const SyntaxError& err) {
+    EXPECT_EQ(err.message,
+              "Syntax error on line 2: read delimiter or reserved word: ,");
+  }
+
+  // Parsers can report their own errors the same way.
+  try {
+    lx.Error("bad input");
+    FAIL() << "expected a syntax error";
+  } catch (const SyntaxError& err) {
+    EXPECT_EQ(err.message, "Syntax error on line 2: bad input");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
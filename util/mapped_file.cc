@@ -0,0 +1,38 @@
+#include "util/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace util {
+
+MappedFile::MappedFile(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Cannot open " << path << ": " << std::strerror(errno);
+
+  struct stat info;
+  CHECK_EQ(fstat(fd, &info), 0)
+      << "Cannot stat " << path << ": " << std::strerror(errno);
+  size_ = info.st_size;
+
+  // Mapping an empty file fails, but there's nothing to map anyway.
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(data != MAP_FAILED)
+        << "Cannot map " << path << ": " << std::strerror(errno);
+    data_ = static_cast<const char*>(data);
+  }
+
+  // The mapping stays valid after the file is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+
+}  // namespace util
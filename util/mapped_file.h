@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string_view>
+
+#include "util/standard_includes.h"
+
+namespace util {
+
+// A read-only memory mapping of an entire file. The file's contents can be
+// used like an in-memory string without being copied into the heap: pages are
+// read in from the file on demand (and can be dropped again by the kernel).
+class MappedFile {
+ public:
+  // Maps the file at 'path'; FATALs if the file can't be opened or mapped.
+  explicit MappedFile(const string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // The contents of the file; only valid for the lifetime of the MappedFile.
+  std::string_view contents() const { return {data_, size_}; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace util
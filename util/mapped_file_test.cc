@@ -0,0 +1,58 @@
+// Tests for the memory-mapped file implementation.
+
+#include "mapped_file.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+using namespace util;
+
+// Writes 'contents' to a new temporary file and returns its name.
+string WriteTempFile(const string& contents) {
+  string filename = std::filesystem::temp_directory_path() /
+                    ("mapped_file_test." + std::to_string(std::rand()));
+  std::ofstream out(filename, std::ios::binary);
+  out << contents;
+  return filename;
+}
+
+TEST(MappedFileTest, Contents) {
+  string contents = "function main() -> int {\nentry:\n  $ret 0\n}\n";
+  contents.push_back('\0');
+  string filename = WriteTempFile(contents);
+
+  {
+    MappedFile file(filename);
+    EXPECT_EQ(file.contents(), contents);
+  }
+
+  std::filesystem::remove(filename);
+}
+
+TEST(MappedFileTest, EmptyFile) {
+  string filename = WriteTempFile("");
+
+  {
+    MappedFile file(filename);
+    EXPECT_EQ(file.contents(), "");
+  }
+
+  std::filesystem::remove(filename);
+}
+
+TEST(MappedFileDeathTest, NonexistentFile) {
+  EXPECT_DEATH(MappedFile("/nonexistent/file.ir"), "Cannot open");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include "util/symbol.h"
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace util {
+
+// The interned strings. The entries are allocated in large blocks and indexed
+// by an open-addressing hash table, so that the pool makes few, large
+// allocations rather than scattering small long-lived ones throughout the
+// heap (which fragments it and slows down everything else). Lookups take a
+// shared lock, so that threads interning the same strings only contend when
+// they see a string for the first time.
+class Symbol::Pool {
+ public:
+  // The pool is never destroyed, so that symbols stay valid while other static
+  // objects are being destroyed.
+  static Pool& Get() {
+    static Pool* pool = new Pool;
+    return *pool;
+  }
+
+  const Entry* Intern(std::string_view str) {
+    size_t hash = std::hash<std::string_view>()(str);
+    {
+      std::shared_lock lock(mutex_);
+      if (const Entry* entry = slots_[Find(str, hash)]) return entry;
+    }
+    std::unique_lock lock(mutex_);
+    size_t slot = Find(str, hash);
+    if (slots_[slot] != nullptr) return slots_[slot];
+
+    const Entry* entry = NewEntry(str, hash);
+    slots_[slot] = entry;
+    // Keep the table at most half full so that probe sequences stay short.
+    if (++size_ * 2 > slots_.size()) Grow();
+    return entry;
+  }
+
+ private:
+  static constexpr size_t kEntriesPerBlock = 1024;
+
+  Pool() : slots_(kEntriesPerBlock, nullptr) {}
+
+  // Returns the slot holding 'str', or else the empty slot where it belongs.
+  size_t Find(std::string_view str, size_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      const Entry* entry = slots_[slot];
+      if (entry == nullptr || (entry->hash == hash && entry->str == str)) {
+        return slot;
+      }
+    }
+  }
+
+  const Entry* NewEntry(std::string_view str, size_t hash) {
+    if (size_ % kEntriesPerBlock == 0) {
+      blocks_.push_back(make_unique<Entry[]>(kEntriesPerBlock));
+    }
+    Entry& entry = blocks_.back()[size_ % kEntriesPerBlock];
+    entry.str = str;
+    entry.hash = hash;
+    return &entry;
+  }
+
+  void Grow() {
+    vector<const Entry*> old_slots(slots_.size() * 2, nullptr);
+    slots_.swap(old_slots);
+    for (const Entry* entry : old_slots) {
+      if (entry != nullptr) slots_[Find(entry->str, entry->hash)] = entry;
+    }
+  }
+
+  std::shared_mutex mutex_;
+
+  // The hash table (a power of two in size) and the number of entries.
+  vector<const Entry*> slots_;
+  size_t size_ = 0;
+
+  // The entries, allocated kEntriesPerBlock at a time.
+  vector<unique_ptr<Entry[]>> blocks_;
+};
+
+Symbol::Symbol() {
+  static const Entry* empty = Pool::Get().Intern("");
+  entry_ = empty;
+}
+
+Symbol::Symbol(std::string_view str) : entry_(Pool::Get().Intern(str)) {}
+
+}  // namespace util
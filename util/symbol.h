@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string_view>
+
+#include "util/standard_includes.h"
+
+namespace util {
+
+// An interned string. Each distinct string is stored once in a process-wide
+// pool and a Symbol is just a handle to it, so symbols are compared and hashed
+// in constant time, and a name repeated throughout a program (e.g., a variable
+// or a basic block label) is only stored once. Interned strings are never
+// freed. Thread-safe.
+class Symbol {
+ public:
+  // The empty string.
+  Symbol();
+
+  explicit Symbol(std::string_view str);
+
+  // The interned string; valid for the life of the process.
+  const string& str() const { return entry_->str; }
+
+  bool empty() const { return entry_->str.empty(); }
+
+  // Returns a hash of the string (the same in every run of the program).
+  size_t hash() const { return entry_->hash; }
+
+  friend bool operator==(Symbol symbol1, Symbol symbol2) {
+    return symbol1.entry_ == symbol2.entry_;
+  }
+
+  friend bool operator!=(Symbol symbol1, Symbol symbol2) {
+    return symbol1.entry_ != symbol2.entry_;
+  }
+
+  // Orders symbols the same as their strings.
+  friend bool operator<(Symbol symbol1, Symbol symbol2) {
+    return symbol1.entry_ != symbol2.entry_ && symbol1.str() < symbol2.str();
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, Symbol symbol) {
+    return os << symbol.str();
+  }
+
+ private:
+  struct Entry {
+    string str;
+    size_t hash;
+  };
+
+  class Pool;
+
+  const Entry* entry_;
+};
+
+// A read-only map from symbols to values, stored as a vector of entries (in
+// the order given) and an open-addressing hash table of indices into it. It's
+// cheap to build and copy, and a lookup is usually a single probe.
+template <typename Value>
+class SymbolMap {
+ public:
+  SymbolMap() = default;
+
+  // FATALs if 'entries' contains duplicate symbols.
+  explicit SymbolMap(vector<pair<Symbol, Value>> entries)
+      : entries_(std::move(entries)) {
+    // Keep the table at most half full.
+    size_t num_slots = 1;
+    while (num_slots < 2 * entries_.size()) num_slots *= 2;
+    slots_.assign(num_slots, kEmpty);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      uint32_t& slot = slots_[Probe(entries_[i].first)];
+      CHECK_EQ(slot, kEmpty) << "Duplicate symbol: " << entries_[i].first;
+      slot = static_cast<uint32_t>(i);
+    }
+  }
+
+  // Returns the value for 'key', or nullptr if there is none.
+  const Value* Find(Symbol key) const {
+    if (entries_.empty()) return nullptr;
+    uint32_t index = slots_[Probe(key)];
+    return index == kEmpty ? nullptr : &entries_[index].second;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  static constexpr uint32_t kEmpty = ~uint32_t{0};
+
+  // Returns the slot holding 'key', or else the empty slot where it belongs.
+  size_t Probe(Symbol key) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = key.hash() & mask;; slot = (slot + 1) & mask) {
+      uint32_t index = slots_[slot];
+      if (index == kEmpty || entries_[index].first == key) return slot;
+    }
+  }
+
+  vector<pair<Symbol, Value>> entries_;
+  vector<uint32_t> slots_;
+};
+
+}  // namespace util
+
+namespace std {
+
+template <>
+struct hash<util::Symbol> {
+  size_t operator()(util::Symbol symbol) const { return symbol.hash(); }
+};
+
+}  // namespace std
@@ -0,0 +1,94 @@
+// Tests for interned symbols.
+
+#include "symbol.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace {
+
+using namespace util;
+
+TEST(SymbolTest, Interning) {
+  string foo = "foo";
+  EXPECT_EQ(Symbol("foo"), Symbol(foo));
+  EXPECT_EQ(&Symbol("foo").str(), &Symbol(foo).str());
+  EXPECT_EQ(Symbol("foo").hash(), Symbol(foo).hash());
+  EXPECT_EQ(std::hash<Symbol>()(Symbol("foo")), Symbol(foo).hash());
+  EXPECT_NE(Symbol("foo"), Symbol("bar"));
+  EXPECT_EQ(Symbol("foo").str(), "foo");
+
+  // Interning a substring doesn't intern the rest of the string.
+  std::string_view foobar = "foobar";
+  EXPECT_EQ(Symbol(foobar.substr(0, 3)), Symbol("foo"));
+}
+
+TEST(SymbolTest, Empty) {
+  EXPECT_EQ(Symbol(), Symbol(""));
+  EXPECT_TRUE(Symbol().empty());
+  EXPECT_FALSE(Symbol("a").empty());
+  EXPECT_EQ(Symbol().str(), "");
+}
+
+TEST(SymbolTest, Ordering) {
+  set<Symbol> symbols = {Symbol("b"), Symbol("c"), Symbol("a"), Symbol("b")};
+  vector<string> strs;
+  for (Symbol symbol : symbols) strs.push_back(symbol.str());
+  EXPECT_EQ(strs, vector<string>({"a", "b", "c"}));
+  EXPECT_FALSE(Symbol("a") < Symbol("a"));
+}
+
+// Threads interning the same new strings must all get the same symbols.
+TEST(SymbolTest, Threads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumStrings = 1000;
+  vector<vector<Symbol>> symbols(kNumThreads);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&symbols, i] {
+      for (int j = 0; j < kNumStrings; j++) {
+        symbols[i].emplace_back("symbol_test_" + std::to_string(j));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int i = 1; i < kNumThreads; i++) EXPECT_EQ(symbols[i], symbols[0]);
+  EXPECT_EQ(symbols[0][42].str(), "symbol_test_42");
+}
+
+TEST(SymbolMapTest, Find) {
+  EXPECT_EQ(SymbolMap<int>().Find(Symbol("a")), nullptr);
+
+  vector<pair<Symbol, int>> entries;
+  for (int i = 0; i < 1000; i++) {
+    entries.emplace_back(Symbol("symbol_map_test_" + std::to_string(i)), i);
+  }
+  SymbolMap<int> map(entries);
+  EXPECT_EQ(map.size(), 1000);
+  for (const auto& [symbol, value] : entries) {
+    ASSERT_NE(map.Find(symbol), nullptr);
+    EXPECT_EQ(*map.Find(symbol), value);
+  }
+  EXPECT_EQ(map.Find(Symbol("symbol_map_test_1000")), nullptr);
+
+  // Copies don't refer to the original.
+  SymbolMap<int> copy = map;
+  map = SymbolMap<int>();
+  EXPECT_EQ(*copy.Find(Symbol("symbol_map_test_42")), 42);
+}
+
+TEST(SymbolMapTest, Duplicates) {
+  EXPECT_DEATH(SymbolMap<int>({{Symbol("a"), 1}, {Symbol("a"), 2}}),
+               "Duplicate symbol: a");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}